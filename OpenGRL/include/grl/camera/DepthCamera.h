@@ -34,6 +34,9 @@ struct Joint {
 };
 
 struct Skeleton {
+    // Identifier of the body, the same in all frames in which the body is
+    // tracked
+	uint64_t id = 0;
 	Joint joints[JointType::COUNT];
     // Lean in the X or Y axis (bigger one is taken)
 	float lean;
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <grl/gesture/FloodFillClipped.h>
+#include <grl/gesture/GestureExtractor.h>
+#include <grl/utils/ObjectPool.h>
+#include <grl/utils/ThreadPool.h>
+
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <opencv/cv.hpp>
+#include <opencv2/core/core.hpp>
+
+namespace grl {
+
+/**
+ * Labelling of the connected components of the whole depth image. Two adjacent
+ * pixels (including the diagonal ones) belong to the same component if the
+ * difference of their depths is within the tolerance, which is the same rule
+ * as for the neighbours in the VoxelArray2D.
+ * The image is labelled once and then any number of objects can be extracted
+ * from it. The labels let the extraction skip the pixels of the other
+ * components without comparing their depths.
+ */
+class ConnectedComponents
+{
+public:
+    /**
+     * Label all pixels of the image. The rows are split into the stripes,
+     * which are labelled in parallel and then joined on their borders.
+     * The image is not copied, it must not be modified until the objects are
+     * extracted.
+     *
+     * @param depthImage depth image of the uint16_t type.
+     * @param tolerance maximum depth difference between two adjacent pixels,
+     * to put them into the same component.
+     * @param nstripes number of the stripes, 0 to use the number of the
+     * hardware threads.
+     */
+    void label(const cv::Mat &depthImage, int tolerance, int nstripes = 0);
+
+    /**
+     * Get number of the components in the labelled image.
+     *
+     * @returns number of the components.
+     */
+    size_t getComponentsNumber() const;
+
+    /**
+     * Get the component of the pixel. The components are numbered in the
+     * order of their first pixel in the image, row by row.
+     *
+     * @param x x coordinate of the pixel.
+     * @param y y coordinate of the pixel.
+     * @returns index of the component.
+     */
+    uint32_t getComponent(int x, int y) const;
+
+    /**
+     * Get number of the pixels in the component.
+     *
+     * @param component index of the component.
+     * @returns number of the pixels.
+     */
+    size_t getComponentSize(uint32_t component) const;
+
+    /**
+     * Extract the object from the component containing the starting point.
+     * The object is the same as from the FloodFillClipped - only the pixels
+     * in front of or on the plane, which are connected to the starting point
+     * through such pixels, are part of it.
+     *
+     * @param[in] startingPoint the point in the image from which the object
+     * is extracted.
+     * @param[in] plane plane which is clipping the object.
+     * @param[out] object structure, to which the object is being saved.
+     * @returns true if the object was extraced, false if the starting point
+     * is behind the plane or outside of the image.
+     */
+    bool extractObject(Vec2i startingPoint, Plane plane, DepthObject &object) const;
+
+    /**
+     * Extract the object only from the region of the image. The pixels
+     * outside of the region are not part of the object and do not connect
+     * its pixels, so the cost depends on the size of the object and the rows
+     * of the region that it reaches. The objects can be extracted from more
+     * threads at the same time.
+     *
+     * @param[in] startingPoint the point in the image from which the object
+     * is extracted.
+     * @param[in] plane plane which is clipping the object.
+     * @param[in] region part of the image in which the object can be, it is
+     * clipped to the image.
+     * @param[out] object structure, to which the object is being saved.
+     * @returns true if the object was extraced, false if the starting point
+     * is behind the plane or outside of the region.
+     */
+    bool extractObject(Vec2i startingPoint, Plane plane, const cv::Rect &region, DepthObject &object) const;
+
+private:
+    // Horizontal run of the pixels, from x0 to x1 inclusive
+    struct Span
+    {
+        int y;
+        int x0;
+        int x1;
+    };
+
+    // Work buffers of one extraction, indexed inside of its region
+    struct Extraction
+    {
+        VisitedMap usedMap;
+        // 1 for the pixels in front of the clipping plane, only the rows
+        // stamped in the classifiedRows are valid
+        std::vector<uint8_t> inFront;
+        VisitedMap classifiedRows;
+        std::vector<Span> spans;
+    };
+
+    cv::Mat _depthImage;
+    int _tolerance = INT_MAX;
+    // Parent of each pixel in the union-find, the root is the pixel with the
+    // lowest index in the set
+    std::vector<uint32_t> _parents;
+    // Component of each pixel
+    std::vector<uint32_t> _labels;
+    // Index of the first pixel of each component in the pixels, one more
+    // element at the end
+    std::vector<uint32_t> _componentBegin;
+    // Indices of the pixels grouped by the components, row by row in each
+    // component
+    std::vector<uint32_t> _pixels;
+    // Workers labelling the stripes, created on the first call of label
+    std::unique_ptr<ThreadPool> _workers;
+    // Buffers of the extractions, each extraction running at the same time
+    // is using its own
+    mutable ObjectPool<Extraction> _extractions;
+
+    uint32_t find(uint32_t pixel);
+    void unite(uint32_t first, uint32_t second);
+    void labelStripe(int yBegin, int yEnd, int tolerance);
+    void uniteRows(int y, int tolerance);
+};
+
+inline size_t
+ConnectedComponents::getComponentsNumber() const
+{
+    return _componentBegin.empty() ? 0 : _componentBegin.size() - 1;
+}
+
+inline uint32_t
+ConnectedComponents::getComponent(int x, int y) const
+{
+    assert(x >= 0 && y >= 0 && x < _depthImage.cols && y < _depthImage.rows);
+    return _labels[static_cast<size_t>(y) * _depthImage.cols + x];
+}
+
+inline size_t
+ConnectedComponents::getComponentSize(uint32_t component) const
+{
+    assert(component < getComponentsNumber());
+    return _componentBegin[component + 1] - _componentBegin[component];
+}
+
+}
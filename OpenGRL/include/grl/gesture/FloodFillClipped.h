@@ -2,7 +2,10 @@
 
 #include <grl/gesture/GestureExtractor.h>
 
+#include <algorithm>
 #include <array>
+#include <climits>
+#include <vector>
 
 #include <opencv/cv.hpp>
 #include <opencv2/core/core.hpp>
@@ -10,50 +13,27 @@
 namespace grl {
 
 /**
- * Expand normal Voxel implementation which are containing additional
- * information required by the FloodFill algorithm.
+ * Maximum number of the neighbours of the voxel - all adjacent voxels.
  */
-constexpr size_t MaxFFVoxelNeighbours = 8;
-struct FFVoxel : public Voxel
-{
-    // For faster access to the data, all neighbours are stored inside the
-    // voxel.
-    std::array<FFVoxel *, MaxFFVoxelNeighbours> neighbours;
-    // Number of neighbours that are stored.
-    int neighboursNumber;
-
-    /**
-     * Basic constructor, doing nothing.
-     */
-    FFVoxel() {}
-
-    /**
-     * Constructor initializing all fields and setting defaults.
-     *
-     * @param x x coordinate of the voxel on the image
-     * @param y y coordinate of the voxel on the image
-     * @param z depth of the voxel
-     */
-    FFVoxel(int x, int y, int z);
-};
+constexpr size_t MaxVoxelNeighbours = 8;
 
 /**
  * Representation of the voxels in the 2D spaces, can be used for converting
- * image to the voxel 2D array.
+ * image to the voxel 2D array. Only the depth of each voxel is stored, the
+ * coordinates are given by the position in the array and the neighbours are
+ * determined when they are requested, by comparing the depth of the adjacent
+ * voxels with the tolerance.
+ * The array can cover only the region of the image. The voxels are still
+ * accessed using the coordinates of the image, but only the voxels inside of
+ * the region exist and only they can be the neighbours.
  */
 class VoxelArray2D
 {
 public:
     /**
-     * Destructor, which is releasing array of voxels if it was allocated but
-     * do not released.
-     */
-    ~VoxelArray2D();
-
-    /**
-     * Initialize voxel array with given with and height. The FFVoxels are
+     * Initialize voxel array with given with and height. The voxels are
      * having set default depth to 0 and are not being modified otherwise.
-     * All adjacent voxels for each voxel are being set as a neighbours.
+     * All adjacent voxels for each voxel are being treated as a neighbours.
      *
      * @param width widht of the voxel array.
      * @param height height of the voxel array.
@@ -63,10 +43,9 @@ public:
     bool init(int width, int height);
 
     /**
-     * Create voxel array using image from data. This function is doing further
-     * optimization and is adding adjacent voxels as a neighbours to the voxel
-     * only if the distance between the depth of two voxels is smaller or equal
-     * to depthTolerance.
+     * Create voxel array using image from data. Adjacent voxels are treated as
+     * the neighbours of the voxel only if the distance between the depth of
+     * two voxels is smaller or equal to depthTolerance.
      *
      * @param depthImage depth image, from which the voxel array will be created.
      * It should be uint16_t type.
@@ -76,55 +55,98 @@ public:
      */
     bool fromImage(const cv::Mat &depthImage, int depthTolerance = INT_MAX);
 
+    /**
+     * Create voxel array using only the region of the image. Pixels outside
+     * of the region are not accessed at all.
+     *
+     * @param depthImage depth image, from which the voxel array will be created.
+     * It should be uint16_t type.
+     * @param depthTolerance maximum depth difference between two adjacent
+     * voxels, to consider them as a neighbours.
+     * @param region part of the image, it is clipped to the image.
+     * @returns true if the array was successfully created
+     */
+    bool fromImage(const cv::Mat &depthImage, int depthTolerance, const cv::Rect &region);
+
     /**
      * Release all allocated resources inside the VoxelArray2D.
      */
     void destroy();
 
     /**
-     * Get reference to the voxel at the given coordinates.
+     * Get the voxel at the given coordinates.
      *
      * @param x x coordinate of the voxel.
      * @param y y coordinate of the voxel.
-     * @returns reference to the voxel in the 2D array.
+     * @returns voxel with the coordinates and the depth.
      */
-    FFVoxel & getVoxel(int x, int y);
+    Voxel getVoxel(int x, int y) const;
 
     /**
-     * Get reference to the voxel at the given coordinates.
+     * Get the voxel at the given coordinates.
      *
      * @param x x coordinate of the voxel.
      * @param y y coordinate of the voxel.
-     * @returns reference to the voxel in the 2D array.
+     * @returns voxel with the coordinates and the depth.
      */
-    const FFVoxel & getVoxel(int x, int y) const;
+    Voxel operator()(int x, int y) const;
 
     /**
-     * Get reference to the voxel at the given coordinates.
+     * Get value of the voxel at the given coordinates.
      *
      * @param x x coordinate of the voxel.
      * @param y y coordinate of the voxel.
-     * @returns reference to the voxel in the 2D array.
+     * @returns value of the voxel
      */
-    FFVoxel & operator()(int x, int y);
+    int getVoxelValue(int x, int y) const;
 
     /**
-     * Get value of the voxel at the given coordinates.
+     * Set value of the voxel at the given coordinates. The neighbours of the
+     * voxel are determined using the new value.
      *
      * @param x x coordinate of the voxel.
      * @param y y coordinate of the voxel.
-     * @returns value of the voxel
      */
-    int getVoxelValue(int x, int y) const;
+    void setVoxelValue(int x, int y, int value);
+
+    /**
+     * Get depths of the row of the voxels. The pointer is shifted, so it can
+     * be indexed with the x coordinates of the image inside of the region.
+     *
+     * @param y y coordinate of the row, inside of the region.
+     * @returns pointer to the depths of the row.
+     */
+    const uint16_t * getRow(int y) const;
 
     /**
-     * Set value of the voxel at the given coordinates. It won't cause
-     * recalculation of the neighbours.
+     * Call fun(nx, ny) for each neighbour of the voxel. The neighbours are
+     * visited row by row, from the top left one to the bottom right one.
      *
      * @param x x coordinate of the voxel.
      * @param y y coordinate of the voxel.
+     * @param fun callable object taking coordinates of the neighbour.
      */
-    void setVoxelValue(int x, int y, int value);
+    template<typename F>
+    void forEachNeighbour(int x, int y, F fun) const;
+
+    /**
+     * Get number of the neighbours of the voxel.
+     *
+     * @param x x coordinate of the voxel.
+     * @param y y coordinate of the voxel.
+     * @returns number of the neighbours, up to MaxVoxelNeighbours.
+     */
+    int getNeighboursNumber(int x, int y) const;
+
+    /**
+     * Get the neighbour of the voxel, in the same order as forEachNeighbour.
+     *
+     * @param x x coordinate of the voxel.
+     * @param y y coordinate of the voxel.
+     * @param i index of the neighbour, lower than getNeighboursNumber(x, y).
+     * @returns neighbour voxel.
+     */
+    Voxel getNeighbour(int x, int y, int i) const;
 
     /**
      * Get size of the voxel array.
@@ -134,11 +156,169 @@ public:
      */
     void getSize(int &width, int &height) const;
 
+    /**
+     * Get the region of the image covered by the array.
+     *
+     * @returns region in the image coordinates.
+     */
+    cv::Rect getRegion() const { return cv::Rect(_x, _y, _width, _height); }
+
+    /**
+     * Check if the voxel with the given image coordinates is in the array.
+     *
+     * @param x x coordinate of the voxel.
+     * @param y y coordinate of the voxel.
+     * @returns true if the voxel is inside of the region.
+     */
+    bool contains(int x, int y) const;
+
+    /**
+     * Get index of the voxel in the array, from 0 to width*height - 1.
+     *
+     * @param x x coordinate of the voxel.
+     * @param y y coordinate of the voxel.
+     * @returns index of the voxel.
+     */
+    size_t getIndex(int x, int y) const;
+
+private:
+    // Region of the image, in the image coordinates
+    int _x = 0;
+    int _y = 0;
+    int _width = 0;
+    int _height = 0;
+    int _tolerance = INT_MAX;
+    // Depth of the voxels, row by row
+    std::vector<uint16_t> _depth;
+};
+
+inline Voxel
+VoxelArray2D::getVoxel(int x, int y) const
+{
+    Voxel voxel;
+    voxel.coords = Vec3i(x, y, _depth[getIndex(x, y)]);
+    return voxel;
+}
+
+inline Voxel
+VoxelArray2D::operator()(int x, int y) const
+{
+    return getVoxel(x, y);
+}
+
+inline int
+VoxelArray2D::getVoxelValue(int x, int y) const
+{
+    return _depth[getIndex(x, y)];
+}
+
+inline bool
+VoxelArray2D::contains(int x, int y) const
+{
+    return x >= _x && y >= _y && x < _x + _width && y < _y + _height;
+}
+
+inline size_t
+VoxelArray2D::getIndex(int x, int y) const
+{
+    assert(contains(x, y));
+    return static_cast<size_t>(x - _x) + static_cast<size_t>(y - _y) * _width;
+}
+
+inline const uint16_t *
+VoxelArray2D::getRow(int y) const
+{
+    assert(y >= _y && y < _y + _height);
+    return _depth.data() + static_cast<size_t>(y - _y) * _width - _x;
+}
+
+template<typename F>
+inline void
+VoxelArray2D::forEachNeighbour(int x, int y, F fun) const
+{
+    int depth = _depth[getIndex(x, y)];
+    int yEnd = clampMax(y + 1, _y + _height - 1);
+    int xEnd = clampMax(x + 1, _x + _width - 1);
+    for (int ny = clampMin(y - 1, _y); ny <= yEnd; ++ny) {
+        const uint16_t *row = getRow(ny);
+        for (int nx = clampMin(x - 1, _x); nx <= xEnd; ++nx) {
+            // Make sure it is not the same voxel
+            if ((ny != y || nx != x) && absBetween(static_cast<int>(row[nx]) - depth, _tolerance))
+                fun(nx, ny);
+        }
+    }
+}
+
+/**
+ * Map of the voxels visited by the extraction. Instead of clearing the whole
+ * map before each extraction, the visited voxels are stamped with the number
+ * of the current extraction, so clearing the map is only incrementing this
+ * number. The whole map is cleared only when the number overflows.
+ */
+class VisitedMap
+{
+public:
+    /**
+     * Resize the map. The voxels which were already in the map are not
+     * cleared, clear must be called before the next extraction.
+     *
+     * @param size number of the voxels in the map.
+     */
+    void resize(size_t size);
+
+    /**
+     * Mark all voxels as not visited.
+     */
+    void clear();
+
+    /**
+     * Check if the voxel was visited since the last clear.
+     *
+     * @param index index of the voxel.
+     * @returns true if the voxel was visited.
+     */
+    bool isVisited(size_t index) const;
+
+    /**
+     * Mark the voxel as visited.
+     *
+     * @param index index of the voxel.
+     */
+    void visit(size_t index);
+
 private:
-    int _width, _height;
-    FFVoxel *_voxels = nullptr;
+    std::vector<uint16_t> _stamps;
+    // Stamp of the voxels visited since the last clear, 0 is never used
+    uint16_t _stamp = 0;
 };
 
+inline void
+VisitedMap::resize(size_t size)
+{
+    _stamps.resize(size, 0);
+}
+
+inline void
+VisitedMap::clear()
+{
+    if (++_stamp == 0) {
+        std::fill(_stamps.begin(), _stamps.end(), static_cast<uint16_t>(0));
+        _stamp = 1;
+    }
+}
+
+inline bool
+VisitedMap::isVisited(size_t index) const
+{
+    return _stamps[index] == _stamp;
+}
+
+inline void
+VisitedMap::visit(size_t index)
+{
+    _stamps[index] = _stamp;
+}
+
 /**
  * Class implementing FloodFill algorithm but it is extracting the object which
  * can be clipped by the plane. Only the points in fron of the plane will be
@@ -158,22 +338,54 @@ public:
      */
     void init(int tolerance, const cv::Mat &source);
 
+    /**
+     * Initialize the object using only the region of the source image. The
+     * objects can be extracted only from the region, the rest of the image
+     * is not accessed, so the cost depends on the size of the region.
+     *
+     * @param tolerance maximum distance between two values of two pixels, to
+     * add the adjacent pixel to the object.
+     * @param source image from which the objects should be extracted.
+     * @param region part of the image in which the objects can be.
+     */
+    void init(int tolerance, const cv::Mat &source, const cv::Rect &region);
+
     /**
      * Extract signle object starting from the given point using the floodfill
      * algorithm. All points behind the plane won't be treated as a part of the
      * object.
+     * The object is filled with the horizontal runs of the voxels, which are
+     * put into the object as a whole, so the voxels are in the order of the
+     * runs.
      *
      * @param[in] startingPoint the point in the image from which the extraction
      * should start.
      * @param[in] plane plane which is additionally clipping the object.
      * @param[out] object structure, to which the object is being saved.
-     * @returns true if the object was extraced
+     * @returns true if the object was extraced, false if the starting point
+     * is behind the plane or outside of the region.
      */
     bool extractObject(Vec2i startingPoint, Plane plane, DepthObject &object);
 private:
+    // Horizontal run of the voxels, from x0 to x1 inclusive
+    struct Span
+    {
+        int y;
+        int x0;
+        int x1;
+    };
+
     int _tolerance;
     VoxelArray2D _voxelImage;
-    std::vector<bool> _usedMap;
+    VisitedMap _usedMap;
+    // 1 for the voxels in front of the clipping plane, 0 for the ones behind
+    // it. Only the rows reached by the extraction are classified, the map
+    // stamps the rows classified during the current extraction.
+    std::vector<uint8_t> _inFront;
+    VisitedMap _classifiedRows;
+    // Runs which neighbouring rows must be still analyzed, reused between
+    // the extractions
+    std::vector<Span> _spans;
 };
 
 }
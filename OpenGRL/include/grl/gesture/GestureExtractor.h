@@ -1,10 +1,13 @@
 #pragma once
 
 #include <grl/camera/DepthCamera.h>
+#include <grl/utils/ThreadPool.h>
 
 #include <opencv/cv.hpp>
 #include <opencv2/core/core.hpp>
 
+#include <memory>
+
 namespace grl {
 
 /**
@@ -16,9 +19,26 @@ struct Voxel
     Vec3i coords;
 };
 
+/**
+ * Horizontal run of the voxels of the object.
+ */
+struct DepthSpan
+{
+    // Coordinates of the first voxel of the run
+    int x;
+    int y;
+    // Number of the voxels in the run
+    int length;
+    // Depths of the voxels of the run
+    const uint16_t *depths;
+};
+
 /**
  * Class representing object extracted from the depth image. It is a 2D object
  * with the depth.
+ * The object owns all of its data, the voxels are stored as horizontal runs,
+ * with the coordinates of the runs and the depths of all voxels kept in the
+ * separate arrays, so the object can be copied cheaply.
  */
 class DepthObject
 {
@@ -31,13 +51,26 @@ public:
 
     /**
      * Put a single Voxel into the object - it will become part of the object
-     * structure.
+     * structure. The voxel is copied into the object.
      * Calling this function is not simply adding Voxel to the vector, it is
-     * also recaulcuating size of the object.
+     * also recaulcuating size of the object. If the voxel is directly after
+     * the last run, it extends the run.
      *
      * @param voxel voxel, which should be added to the object strucutre.
      */
-    void putVoxel(const Voxel *voxel);
+    void putVoxel(const Voxel &voxel);
+
+    /**
+     * Put horizontal run of voxels into the object. The voxels are added in
+     * the order of the run and the size of the object is recalculated once
+     * for the whole run.
+     *
+     * @param x x coordinate of the first voxel of the run.
+     * @param y y coordinate of all voxels of the run.
+     * @param depths depths of the voxels of the run.
+     * @param count number of voxels in the run.
+     */
+    void putSpan(int x, int y, const uint16_t *depths, int count);
 
     /**
      * Get number of voxels which are creating an object.
@@ -53,13 +86,21 @@ public:
     void reset();
 
     /**
-     * Get Voxels which are creating the object. Note, that the Voxels won't be
-     * sorted in any way and are stored in the order that they were put into the
-     * object.
+     * Get number of the horizontal runs of the voxels creating the object.
      *
-     * @returns vector containing voxels creating object.
+     * @returns number of the runs.
      */
-    const std::vector<const Voxel *> & getVoxels() const;
+    size_t getSpansNumber() const;
+
+    /**
+     * Get the run of the voxels. Note, that the runs won't be sorted in any
+     * way and are stored in the order that they were put into the object.
+     * The depths are valid until the object is modified.
+     *
+     * @param i index of the run, lower than getSpansNumber().
+     * @returns run of the voxels.
+     */
+    DepthSpan getSpan(size_t i) const;
 
     /**
      * Indicates how good was extraction of the object, where 0 is no extraction
@@ -122,9 +163,43 @@ public:
      */
     const cv::Mat & getDepthImageOfObject() const;
 
+    /**
+     * Get mask of the object in the size of the bounding box. The voxels of
+     * the object are set to 255, the rest to 0.
+     *
+     * @param[out] mask CV_8UC1 image with the mask.
+     */
+    void getMask(cv::Mat &mask) const;
+
+    /**
+     * Get depth image of the object in the size of the bounding box, with
+     * the depth converted from milimeters to meters. Pixels which are not
+     * the part of the object are set to 0.
+     *
+     * @param[out] depth CV_32FC1 image with the depth in meters.
+     */
+    void getDepthInMeters(cv::Mat &depth) const;
+
+    /**
+     * Get depth image of the object in meters, like above, but using the
+     * buffer as the storage of the image. The buffer grows only if it is too
+     * small, so when it is reused between the frames, the image is not
+     * allocated again.
+     *
+     * @param[in,out] buffer storage of the image.
+     * @param[out] depth CV_32FC1 image with the depth in meters, valid until
+     * the buffer is modified.
+     */
+    void getDepthInMeters(std::vector<float> &buffer, cv::Mat &depth) const;
+
 private:
-    // Voxels, which are creating object
-    std::vector<const Voxel *> _voxels;
+    // Coordinates of the first voxel of each run
+    std::vector<int> _spanX;
+    std::vector<int> _spanY;
+    // Index of the first voxel of each run in the depths
+    std::vector<size_t> _spanBegin;
+    // Depths of all voxels, run after run
+    std::vector<uint16_t> _depths;
 
     // Depth image of the object
     mutable cv::Mat _depthImage;
@@ -146,17 +221,25 @@ private:
     // How good is the detection of the object
     uint8_t _accuracy;
 
-    // Recalculate both bounding box and the depth with the given input voxel.
-    void recalculate3DBoundingBox(const Voxel *voxel);
+    // Extend both bounding box and the depth range by the run of the voxels.
+    void extendBounds(int xBegin, int xEnd, int y, int minDepth, int maxDepth);
     // Generate
     void generateImage() const;
+    // Write the depth of all runs in meters into the zeroed image of the size
+    // of the bounding box.
+    void putSpansInMeters(cv::Mat &depth) const;
 };
 
 /**
- * Configuration of the extractor. As for now, it is empty but configurations
- * of the inherited classes should be using this struct as a parent.
+ * Configuration of the extractor. Configurations of the inherited classes
+ * should be using this struct as a parent.
  */
-struct ExtractorConfig {};
+struct ExtractorConfig
+{
+    // Extract the left and the right hand at the same time. The left hand is
+    // extracted by the worker thread owned by the extractor.
+    bool parallelHands = false;
+};
 
 /**
  * Interface, which should be used for all tools and algorithms that will be
@@ -188,6 +271,36 @@ public:
                       DepthObject &leftHand,
                       DepthObject &rightHand);
 
+    /**
+     * Prepare the data shared by all skeletons detected on the image. It must
+     * be called once for the image, before the hands of its skeletons are
+     * extracted using extractPreparedHands. By default, nothing is prepared.
+     *
+     * @param depthImage image, from which the hands will be extracted.
+     */
+    virtual void prepareFrame(const cv::Mat &depthImage);
+
+    /**
+     * Extract both hands of the skeleton from the image, which was already
+     * prepared using prepareFrame. The hands of the different skeletons of
+     * the same image can be extracted at the same time from many threads.
+     * The callers running in parallel should not use the hand worker, as
+     * there is only one for all of them.
+     *
+     * @param[in] depthImage image, from which the hands have to be extracted.
+     * @param[in] skeleton skeleton of the person detected on the image.
+     * @param[out] leftHand object with voxels creating left hand.
+     * @param[out] rightHand object with voxels creating right hand.
+     * @param[in] useHandWorker extract the left hand by the hand worker, if
+     * the parallel hands are enabled. If false, both hands are extracted by
+     * the calling thread.
+     */
+    void extractPreparedHands(const cv::Mat &depthImage,
+                              const Skeleton &skeleton,
+                              DepthObject &leftHand,
+                              DepthObject &rightHand,
+                              bool useHandWorker = true);
+
 protected:
     // Helper enumeration, dictating which hand: left or right, have to be
     // extracted.
@@ -212,7 +325,8 @@ protected:
 
     /**
      * Extract hand from the image using the depth image and the skeleton of the
-     * person.
+     * person. It can be called from many threads at the same time, for the
+     * different hands and skeletons.
      *
      * @param[in] side hand which must be extracted, left or right.
      * @param[in] depthImage image, which can be used for hand extraction.
@@ -226,6 +340,12 @@ protected:
                              DepthObject &hand) = 0;
 
     virtual void prepareExtraction(const cv::Mat &depthImage, const Skeleton &skeleton) = 0;
+
+private:
+    // Worker extracting the left hand, only if the hands are extracted in
+    // parallel. In such case, extractHand must not share any state between
+    // the hands.
+    std::unique_ptr<ThreadPool> _handWorker;
 };
 
 }
@@ -11,6 +11,10 @@
 #include <grl/track/TrackClassificator.h>
 #include <grl/gesture/GestureClassificator.h>
 #include <grl/utils/Profiler.h>
+#include <grl/utils/ThreadPool.h>
+
+#include <map>
+#include <memory>
 
 namespace grl {
 
@@ -62,6 +66,23 @@ enum RecognitionMode
 class GestureRecognizer
 {
 public:
+    // State of the single person in the multi-person mode. It is kept as long
+    // as the body is tracked by the camera.
+    struct BodyState
+    {
+        Skeleton skeleton;
+        // Initialized with the config of the right tracker of the recognizer
+        std::unique_ptr<GestureTracker> rightTracker;
+        GestureTracker::UpdateState lastTrackerState = GestureTracker::grlTrackerBuffered;
+        TrackClassificator::TrackMatchDescriptor trackDesc = {};
+        DepthObject leftHand;
+        DepthObject rightHand;
+        HandSkeleton rightHandSkeleton;
+        GestureClassificator::GestureMatchDescriptor gestureDesc = {};
+        // What was recognized for the body in the last update
+        uint64_t status = GotNothing;
+    };
+
 	bool init(DepthCamera *camera,
               GestureExtractor *extractor,
               GestureTracker *rightTracker, // Single hand for now
@@ -76,6 +97,15 @@ public:
 	uint64_t update(RecognitionMode mode = All);
 
     bool isValid() { return _valid; }
+
+    // Recognize all valid persons in front of the camera instead of only the
+    // closest one. The persons are identified by the body ID of the skeleton
+    // and processed in parallel, using nthreads threads (0 for the number of
+    // the hardware threads). The results are available in getBodies(), while
+    // the getters of the single person are returning only the skeleton of
+    // the closest person.
+    void setMultiPerson(bool enabled, size_t nthreads = 0);
+    bool isMultiPerson() const { return _bodyWorkers != nullptr; }
 	void destroy();
 
     // Getters for all objects used for recognition
@@ -97,6 +127,9 @@ public:
     const GestureClassificator::GestureMatchDescriptor & getGestureMatch() { return _gestureDesc; }
     // What GestureTracker returned last time the update() was called.
     GestureTracker::UpdateState getLastTrackerState() const { return _lastTrackerState; };
+    // Persons recognized in the last update in the multi-person mode, by the
+    // body ID.
+    const std::map<uint64_t, BodyState> & getBodies() const { return _bodies; }
 
 private:
 	// Data, which can be received by the upper layer for presentation
@@ -122,6 +155,17 @@ private:
 
     GestureTracker::UpdateState _lastTrackerState;
 	bool _valid = false;
+
+    // Multi-person mode
+    std::map<uint64_t, BodyState> _bodies;
+    std::unique_ptr<ThreadPool> _bodyWorkers;
+
+    // Keep the state only of the bodies with the given skeletons and update
+    // their skeletons.
+    void updateBodies(const std::vector<Skeleton *> &skeletons);
+    // Take all recognition steps after the skeleton extraction for the body.
+    // Can be called for many bodies at the same time.
+    uint64_t updateBody(BodyState &body, RecognitionMode mode, const cv::Mat &depthFrame);
 };
 
 }
\ No newline at end of file
@@ -2,6 +2,12 @@
 
 #include <grl/gesture/HandSkeletonExtractor.h>
 #include <grl/rdf/RandomDecisionForest.h>
+#include <grl/utils/ObjectPool.h>
+#include <grl/utils/ThreadPool.h>
+
+#include <future>
+#include <memory>
+#include <mutex>
 
 namespace grl {
 
@@ -14,19 +20,45 @@ public:
     // coordinates using the camera space of the camera.
     bool init(const std::string &fileWithRDF, const DepthCamera *camera = nullptr);
 
+    // Load the new RDF on the background thread and replace the current one
+    // once it is loaded. Each frame uses the forest that was current when the
+    // frame started, so the frames being processed finish on the old forest,
+    // which is released after the last of them. If the file cannot be loaded,
+    // the current forest is kept. Loads are done in the order of the calls,
+    // so the last requested forest is the one used at the end. The returned
+    // future tells if the forest was replaced.
+    std::future<bool> loadForestAsync(const std::string &fileWithRDF);
+
+    // Forest used by the frames started now, can be nullptr if none was
+    // loaded yet.
+    std::shared_ptr<const RandomDecisionForest> getForest() const { return std::atomic_load(&_forest); }
+
+    // Can be called from many threads at the same time, for the different
+    // hands.
     void extractSkeleton(const grl::DepthObject &hand, grl::HandSkeleton &handSkeleton) override;
 
     // Just for debug and data presentation, it returns image with hand classes.
     // However, this is not the RGB image, the classes contains values like 1, 2, 3, etc.
     // representing the class ID. It must be further converted.
-    cv::Mat getLastClasses() { return _lastClasses; }
+    cv::Mat getLastClasses() const;
 
 private:
     using JointsApproximation = std::array<grl::HandJoint, grl::grlHandIndexNum>;
 
     cv::Mat _lastClasses;
-    grl::RandomDecisionForest _forest;
-    const grl::DepthCamera *_camera;
+    mutable std::mutex _lastClassesMutex;
+    // Storage of the depth of the hand in meters, reused between the frames
+    ObjectPool<std::vector<float> > _depthBuffers;
+    // Accessed only with atomic_load and atomic_store
+    std::shared_ptr<const grl::RandomDecisionForest> _forest;
+    const grl::DepthCamera *_camera = nullptr;
+    // Created on the first asynchronous load. Declared after the forest, so
+    // it is destroyed first and waits for the pending loads.
+    std::unique_ptr<ThreadPool> _loader;
+
+    // Load the forest and make it current. Returns false if it cannot be
+    // loaded.
+    bool setForest(const std::string &fileWithRDF);
 
     // Density estimator using the gaussian kernel. It returns the gradient and
     // the certainty of the location. The certainty is calculated using the sum
@@ -42,10 +74,6 @@ private:
         grl::HandSkeleton &skeleton,
         const grl::ClassesPoints &bestProbabilities);
 
-    // The depth camera is returning depth frame in uint16 representing millimeters,
-    // while the RDF is using floats representing meters.
-    static void convertDepthForRDF(const DepthObject &hand, cv::Mat &convertedDepth);
-
     // Big kernel for big hand parts
     static const GaussianKernel _kernelBig;
     // Small kernel for small parts, like fingers
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <grl/gesture/GestureExtractor.h>
+#include <grl/gesture/ConnectedComponents.h>
 #include <grl/gesture/FloodFillClipped.h>
+#include <grl/utils/ObjectPool.h>
 
 namespace grl {
 
@@ -13,6 +15,15 @@ struct SkeletonExtractorConfig : ExtractorConfig
 {
     // Tolerance of the depth for FloodFill.
     int depthTolerance;
+    // Maximum size of the hand in the units of the world coordinates of the
+    // joints. The FloodFill is limited to the region around the wrist and
+    // the elbow extended by this size, projected using the distance between
+    // the joints in the image and in the world. 0 means the whole image.
+    float maxHandSize = 0.25f;
+    // Label the connected components of the whole image once and extract the
+    // hands from the components instead of using the FloodFill for each hand.
+    // The hands are the same, the region of the hand limits both.
+    bool connectedComponents = false;
 };
 
 /**
@@ -32,6 +43,14 @@ public:
      */
     bool init(const SkeletonExtractorConfig &config);
 
+    /**
+     * Label the connected components of the image, if they are used instead
+     * of the flood fill.
+     *
+     * @param depthImage depth image of the hands.
+     */
+    virtual void prepareFrame(const cv::Mat &depthImage) override;
+
 protected:
     /**
      * Check if the hand is visiable on the image and can be extraced with the
@@ -58,12 +77,29 @@ protected:
 
     virtual void prepareExtraction(const cv::Mat &depthImage, const Skeleton &skeleton) override;
 
+    /**
+     * Get the region of the image, in which the hand can be. It is the
+     * bounding box of the wrist and the elbow extended by the maximum size of
+     * the hand.
+     *
+     * @param side Hand (left/right) for which the region is calculated.
+     * @param depthImage depth image of the hands.
+     * @param skeleton skeleton of the person detected on the image.
+     * @returns region clipped to the image, whole image if the size of the hand
+     * in the image cannot be determined.
+     */
+    cv::Rect getHandRegion(Side side, const cv::Mat &depthImage, const Skeleton &skeleton) const;
+
 private:
     // Configuration of the extractor.
     SkeletonExtractorConfig _config;
-    // Flood fill which is extracting the object on the image with possibility
-    // to use the plane for taking in only some voxels (in front of the plane).
-    FloodFillClipped _ff;
+    // Flood fills which are extracting the object on the image with
+    // possibility to use the plane for taking in only some voxels (in front of
+    // the plane). Each hand extracted at the same time is using its own.
+    ObjectPool<FloodFillClipped> _floodFills;
+    // Components of the whole image, used instead of the flood fill if it is
+    // enabled in the configuration. Labelled once for the image.
+    ConnectedComponents _components;
 };
 
 inline bool
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <grl/rdf/TrainingBackend.h>
+
+namespace grl {
+
+// Scalar backend, the pixels are evaluated in parallel with OpenMP if there
+// are enough of them.
+class CPUTrainingBackend : public TrainingBackend
+{
+public:
+    const char * getName() const override { return "CPU"; }
+
+    bool setNodePixels(const TrainingPixels &pixels,
+                       const std::vector<cv::Mat> &depthImages) override;
+
+    bool getClassCounts(const TrainingPixels &pixels, ClassCounts &counts) override;
+
+    bool evaluateDecision(const Decision &decision,
+                          const TrainingPixels &pixels,
+                          std::vector<uint8_t> &directions,
+                          ClassCounts &leftCounts) override;
+};
+
+// Backend evaluating the decisions for the blocks of 8 pixels with AVX2. The
+// offsets are rounded half away from zero, as std::round does, so the
+// directions are exactly the same as for the scalar backend.
+class AVX2TrainingBackend : public CPUTrainingBackend
+{
+public:
+    const char * getName() const override { return "AVX2"; }
+
+    bool evaluateDecision(const Decision &decision,
+                          const TrainingPixels &pixels,
+                          std::vector<uint8_t> &directions,
+                          ClassCounts &leftCounts) override;
+
+    // Check if the CPU and the OS support AVX2.
+    static bool isSupported();
+};
+
+}
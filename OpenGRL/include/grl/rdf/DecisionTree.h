@@ -4,36 +4,24 @@
 #include <CL/cl.hpp>
 #endif
 
+#include <grl/rdf/Entropy.h>
+#include <grl/rdf/RandomStream.h>
 #include <grl/rdf/RDFUtils.h>
+#include <grl/rdf/TrainingBackend.h>
+#include <grl/rdf/TrainingMemory.h>
+#include <grl/rdf/TrainingMetrics.h>
 
 #include <cassert>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <limits>
-#include <random>
 #include <fstream>
 #include <iostream>
 
 namespace grl {
 
 #ifdef USE_GPU
-struct TreeTrainGPUContext
-{
-    // Delivered to the tree
-    cl::Device device;
-    cl::Context context;
-    cl::Program program;
-    cl::CommandQueue queue;
-    cl::Buffer bufferAllPix;
-    cl::Buffer bufferSplit;
-    cl::Buffer bufferPix;
-    cl::Buffer bufferPixCount;
-    // programs
-    cl::Kernel getFeatureTrain;
-    cl::Kernel getProbabilities;
-    int maxImages;
-};
-
 #pragma pack(push, 1)
 struct Decision
 {
@@ -45,8 +33,6 @@ struct Decision
 };
 #pragma pack(pop)
 #else // !USE_GPU
-typedef void * TreeTrainGPUContext;
-
 struct Decision
 {
     // Offsets
@@ -75,17 +61,89 @@ constexpr uint8_t grlNodeGoRight = 1;
 // values very close to 0 are considered as background.
 constexpr float grlDepthMaxDist = 8.0f;
 
+// Get the offset scaled by the reciprocal of the pixel's depth. The same
+// arithmetic must be used for training and classification, so that the
+// decisions are evaluated exactly the same.
+inline int
+getScaledOffset(int offset, float invDepth)
+{
+    return static_cast<int>(std::round(offset*invDepth));
+}
+
+// Check where the pixel should go for the decision. The depth of the pixels
+// pointed by the offsets u and v (scaled by the depth of the pixel) is
+// compared with the threshold. If any of them is outside of the image or
+// is background, the pixel goes right.
+// image - depth image data with rows of stride floats
+inline uint8_t
+evaluateDecision(const Decision &decision, const float *image, int cols, int rows, size_t stride,
+                 int x, int y, float invDepth)
+{
+    bool backgroundHit;
+
+    // Offset u
+    Vec2i tu = Vec2i{
+        x + getScaledOffset(decision.u.x, invDepth),
+        y + getScaledOffset(decision.u.y, invDepth)
+    };
+    // Check if on border
+    backgroundHit = !isBetween(tu.x, cols-1, 0) ||
+                    !isBetween(tu.y, rows-1, 0);
+    if (backgroundHit)
+        return grlNodeGoRight;
+
+    // Check is depth is background
+    float udepth = image[tu.y*stride + tu.x];
+    backgroundHit = udepth > grlDepthMaxDist || udepth < epsilon;
+    if (backgroundHit)
+        return grlNodeGoRight;
+
+    // Offset v
+    Vec2i tv = Vec2i{
+        x + getScaledOffset(decision.v.x, invDepth),
+        y + getScaledOffset(decision.v.y, invDepth)
+    };
+    // Check if on border
+    backgroundHit = !isBetween(tv.x, cols-1, 0) ||
+                    !isBetween(tv.y, rows-1, 0);
+    if (backgroundHit)
+        return grlNodeGoRight;
+
+    // Check is depth is background
+    float vdepth = image[tv.y*stride + tv.x];
+    backgroundHit = vdepth > grlDepthMaxDist || vdepth < epsilon;
+    if (backgroundHit)
+        return grlNodeGoRight;
+
+    return ((udepth - vdepth) < decision.t) ? grlNodeGoLeft : grlNodeGoRight;
+}
+
+inline uint8_t
+evaluateDecision(const Decision &decision, const TrainingPixels &pixels, size_t i)
+{
+    return evaluateDecision(decision, pixels.getImages()[i], pixels.getCols(), pixels.getRows(),
+                            pixels.getStride(), pixels.getX()[i], pixels.getY()[i],
+                            pixels.getInvDepth()[i]);
+}
+
+inline uint8_t
+evaluateDecision(const Decision &decision, const cv::Mat &depthImage, const Pixel &p)
+{
+    return evaluateDecision(decision, depthImage.ptr<float>(), depthImage.cols, depthImage.rows,
+                            depthImage.step1(), p.coords.x, p.coords.y, 1.0f / p.depth);
+}
+
 // Node of the DecisionTree
 class Node
 {
 public:
     Node(Node *parent = nullptr);
-    Node(std::vector<Pixel> *pixels, const std::vector<float> &probabilities, Node *parent = nullptr);
+    Node(TrainingPixels *pixels, const std::vector<float> &probabilities, Node *parent = nullptr);
     Node(const Decision &decision, Node *parent = nullptr);
     Node(const std::vector<float> &probabilities, Node *parent = nullptr);
 
-    void setPixels(std::vector<Pixel> *pixels) { _pixels = pixels; }
-    std::vector<Pixel> * getPixels() { return _pixels; }
+    void setPixels(TrainingPixels *pixels) { _pixels = pixels; }
+    TrainingPixels * getPixels() { return _pixels; }
 
     Node * getLeft() { return _left.get(); }
     Node * getRight() { return _right.get(); }
@@ -111,13 +169,13 @@ public:
 
     void saveToFile(std::ofstream &file);
 
-    const Node * getLeafForPixel(const cv::Mat &depthImage, const Pixel &p);
+    const Node * getLeafForPixel(const cv::Mat &depthImage, const Pixel &p) const;
 
 private:
     bool _isLeaf = false;
     Node *_parent;
     // Used for training
-    std::vector<Pixel> *_pixels = nullptr;
+    TrainingPixels *_pixels = nullptr;
     std::unique_ptr<Node> _left;
     std::unique_ptr<Node> _right;
 
@@ -132,7 +190,7 @@ Node::Node(Node *parent)
 }
 
 inline
-Node::Node(std::vector<Pixel> *pixels, const std::vector<float> &probabilities, Node *parent)
+Node::Node(TrainingPixels *pixels, const std::vector<float> &probabilities, Node *parent)
     : _parent(parent)
     , _pixels(pixels)
 {
@@ -168,6 +226,9 @@ Node::setProbabilities(const std::vector<float> &probabilities)
 }
 
 
+// Class counts of the pixels that reached each leaf of the tree
+using LeafCounts = std::unordered_map<const Node *, ClassCounts>;
+
 // Decision tree, part of the decision forest
 class DecisionTree
 {
@@ -176,32 +237,50 @@ public:
     // passed as a reference to check the relative depth depending on the
     // random feature.
     // nodeTrainLimit - how many times the feature will be extracted to find the best one
-    // gen - random number generator for generating random decisions
-    // gpuContext - if not using GPU can be null.
-    void train(std::vector<Pixel> *pixels, const std::vector<cv::Mat> &depthImages,
-               int nodeTrainLimit, int maxDepth, std::mt19937 &gen, TreeTrainGPUContext *gpuContext);
+    // stream - random stream of the tree, the candidate decisions are drawn
+    // from its substreams, so the tree depends only on the stream
+    // backend - computes the class counts and evaluates the decisions.
+    // memory - accounts the pixels of the open nodes, the tree takes the
+    // ownership of the pixels, so they are accounted by it as well.
+    // nodeMetrics - metrics of the trained nodes, in the order of training.
+    // Returns false if the backend failed, the tree is empty in such case.
+    bool train(TrainingPixels *pixels, const std::vector<cv::Mat> &depthImages,
+               int nodeTrainLimit, int maxDepth, const RandomStream &stream, TrainingBackend &backend,
+               TreeMemoryTracker &memory, std::vector<NodeMetrics> &nodeMetrics);
+
+    // Get the candidate decision for the node. Nodes are numbered as in the
+    // binary heap - root is 1 and children of node n are 2n and 2n + 1. The
+    // candidate does not depend on any other candidate, so they can be
+    // generated in any order or in parallel.
+    static Decision getCandidate(const RandomStream &stream, uint64_t nodeID, int candidate);
+
+    // Count the nodes and the leaves of the tree and find its depth, the
+    // root is at depth 1. All are 0 for the empty tree.
+    void getSize(size_t &nodes, size_t &leaves, int &depth) const;
 
     void setRoot(std::unique_ptr<Node> root) { _root = std::move(root); }
     Node * getRoot() { return _root.get(); }
+    const Node * getRoot() const { return _root.get(); }
 
     void saveToFile(std::ofstream &file);
     void readFromFile(std::ifstream & file);
 
+    // Replace the probabilities of the leaves with the distribution of the
+    // counted classes, the structure of the tree is not changed. Leaves that
+    // were not reached by any pixel keep their probabilities.
+    void refitLeaves(const LeafCounts &counts);
+
     // Get the probabilities vector for the pixel p of begin part of each class.
-    const std::vector<float> & classifyPixel(const cv::Mat &depthImage, const Pixel &p);
+    const std::vector<float> & classifyPixel(const cv::Mat &depthImage, const Pixel &p) const;
 
 private:
     struct NodeTrainingData {
-        std::vector<Pixel> *allPixels;
-        std::vector<float> allProbabilities;
-        std::vector<uint16_t> imageIDs;
-        std::vector<int> imagesPixelCount;
+        TrainingPixels *allPixels;
+        ClassCounts allCounts;
 
-        std::vector<Pixel> *leftPixels;
-        std::vector<float> leftProbabilities;
-
-        std::vector<Pixel> *rightPixels;
-        std::vector<float> rightProbabilities;
+        // Direction of each pixel for the evaluated decision
+        std::vector<uint8_t> directions;
+        ClassCounts leftCounts;
     };
 
     std::unique_ptr<Node> _root;
@@ -209,47 +288,44 @@ private:
     float _maxThresh;
     int _maxDepth;
 
-    void getProbabilities(const std::vector<Pixel> *pixels, std::vector<float> &probabilities);
-    float evaluateNode(Node *node, NodeTrainingData &data, const std::vector<cv::Mat> &depthImages);
+    // Get the information gain of the split evaluated by the backend.
+    static double getSplitScore(const NodeTrainingData &data);
 
-#ifdef USE_GPU
-    void getProbabilities(const std::vector<Pixel> *pixels, std::vector<float> &probabilities,
-                          TreeTrainGPUContext *gpuContext);
-    float evaluateNode(Node *node, NodeTrainingData &data, const std::vector<cv::Mat> &depthImages,
-                       TreeTrainGPUContext *gpuContext);
-#endif
+    // Free the pixels left in the nodes and remove the tree.
+    void abortTraining(TreeMemoryTracker &memory);
+
+    // Free the pixels of the node, if it has any, and release their memory.
+    static void releasePixels(Node *node, TreeMemoryTracker &memory);
 
-    // Check if the probabilities vector is having only 100% probability for
-    // one entry only.
-    bool isSingleClass(const std::vector<float> &probabilities);
+    // Normalize the counts to the probabilities stored in the nodes.
+    static void getProbabilities(const ClassCounts &counts, std::vector<float> &probabilities);
 
-    float getShannonEntropy(const std::vector<float> &probabilities);
+    // Check if all of the pixels are from one class only.
+    static bool isSingleClass(const ClassCounts &counts);
 };
 
+inline void
+DecisionTree::getProbabilities(const ClassCounts &counts, std::vector<float> &probabilities)
+{
+    uint32_t sum = getCountsSum(counts);
+
+    probabilities.resize(counts.size());
+    auto itp = probabilities.begin();
+    for (auto itc = counts.cbegin(); itc != counts.cend(); ++itc, ++itp)
+        *itp = sum == 0 ? 0.0f : static_cast<float>(*itc) / sum;
+}
+
 inline bool
-DecisionTree::isSingleClass(const std::vector<float> &probabilities)
+DecisionTree::isSingleClass(const ClassCounts &counts)
 {
     int notZero = 0;
-    for (auto it = probabilities.cbegin(); it != probabilities.cend(); ++it)
-        if (*it != 0.0f)
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it)
+        if (*it != 0)
             ++notZero;
 
     return notZero == 1;
 }
 
-inline float
-DecisionTree::getShannonEntropy(const std::vector<float> &probabilities)
-{
-    float entropy = 0.0f;
-    for (auto it = probabilities.cbegin(); it != probabilities.cend(); ++it) {
-        float val = *it;
-        if (val != 0.0f)
-            entropy += val*log2(val);
-    }
-
-    return -entropy;
-}
-
 inline void
 DecisionTree::saveToFile(std::ofstream & file)
 {
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <grl/rdf/RDFUtils.h>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace grl {
+
+// Number of the pixels of each class
+using ClassCounts = std::array<uint32_t, grlHandIndexNum>;
+
+// Scoring of the splits on the integer class counts. The entropy of the set
+// of N pixels with c_i pixels of class i can be written as
+// N*H = N*log2(N) - sum(c_i*log2(c_i)), so the information gain of the split
+// needs only the n*log2(n) values, which are precomputed for the counts up
+// to tableSize. The counts are not normalized and log2 is not called for
+// them, so the score of the split does not depend on the order in which the
+// pixels were counted.
+class EntropyTable
+{
+public:
+    static constexpr uint32_t tableSize = 1 << 20;
+
+    // The table is built on the first use and shared by all of the trees.
+    static const EntropyTable & getInstance();
+
+    // Get n*log2(n), 0 for n = 0.
+    double nlog2n(uint32_t n) const;
+
+    // Get N*H for the set with the given counts.
+    double getScaledEntropy(const ClassCounts &counts) const;
+
+    // Get the information gain of splitting the parent set into the left set
+    // and the rest of the pixels. The gain is the same as
+    // H(parent) - |L|/N*H(L) - |R|/N*H(R) calculated on the probabilities.
+    double getGain(const ClassCounts &parent, const ClassCounts &left) const;
+
+private:
+    std::vector<double> _table;
+
+    EntropyTable();
+};
+
+inline double
+EntropyTable::nlog2n(uint32_t n) const
+{
+    if (n < tableSize)
+        return _table[n];
+
+    return n * std::log2(static_cast<double>(n));
+}
+
+// Get number of the pixels in the set.
+inline uint32_t
+getCountsSum(const ClassCounts &counts)
+{
+    uint32_t sum = 0;
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it)
+        sum += *it;
+
+    return sum;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <grl/rdf/RandomStream.h>
+#include <grl/rdf/RDFUtils.h>
+
+#include <array>
+#include <vector>
+
+namespace grl {
+
+// List of the foreground pixels of one class image, grouped by class, that
+// can be used for drawing the training pixels without replacement. The list
+// is built once, so the cost of drawing does not depend on the amount of the
+// background in the image.
+class ForegroundSampler
+{
+public:
+    ForegroundSampler() = default;
+    // Build the list of the foreground pixels of the CV_8SC1 class image.
+    explicit ForegroundSampler(const cv::Mat &classImage);
+
+    void build(const cv::Mat &classImage);
+
+    // Number of the foreground pixels in the image.
+    size_t getForegroundSize() const { return _pixels.size(); }
+    // Number of the pixels of the given class in the image.
+    size_t getClassSize(int8_t classIndex) const;
+
+    // Draw exactly min(n, getForegroundSize()) distinct pixels by the partial
+    // Fisher-Yates shuffle and append their coordinates to samples.
+    // If stratified is true, the samples are split as evenly as possible
+    // between the classes present in the image. Classes that do not have
+    // enough pixels give away the rest of their share to the others.
+    // scratch is a work buffer of the calling thread, which can be reused
+    // between the calls and the samplers to avoid allocations. It must be
+    // empty on the first call and must not be modified by the caller. The
+    // sampler is not modified, so it can be shared between the threads.
+    void sample(size_t n, bool stratified, RandomStream &stream,
+                std::vector<cv::Point> &samples, std::vector<uint32_t> &scratch) const;
+
+private:
+    int _cols = 0;
+    // Linear indices of the foreground pixels, sorted by class
+    std::vector<uint32_t> _pixels;
+    // Pixels of class c are in range [_classStart[c], _classStart[c + 1])
+    std::array<uint32_t, grlHandIndexNum + 1> _classStart = {};
+
+    // Draw n distinct elements from range [first, last) of the list. The
+    // positions in the range are shuffled in scratch, which is the identity
+    // permutation again before returning.
+    void drawRange(size_t first, size_t last, size_t n, RandomStream &stream,
+                   std::vector<cv::Point> &samples, std::vector<uint32_t> &scratch) const;
+};
+
+inline
+ForegroundSampler::ForegroundSampler(const cv::Mat &classImage)
+{
+    build(classImage);
+}
+
+inline size_t
+ForegroundSampler::getClassSize(int8_t classIndex) const
+{
+    if (classIndex < grlHandIndexStart || classIndex >= grlHandIndexNum)
+        return 0;
+
+    return _classStart[classIndex + 1] - _classStart[classIndex];
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "RandomDecisionForest.h"
+
+#include <array>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace grl {
+
+// Class index used for the background in the confusion matrix
+constexpr size_t grlEvaluationBackground = grlHandIndexNum;
+constexpr size_t grlEvaluationClassesNum = grlHandIndexNum + 1;
+
+// Rows are the reference classes, columns the classes found by the forest.
+// The last row and column is the background.
+using ConfusionMatrix = std::array<std::array<uint64_t, grlEvaluationClassesNum>, grlEvaluationClassesNum>;
+
+// Measures the accuracy and the speed of the forest on the images with known
+// classes. The images are classified in parallel, each by one thread, so the
+// pixels per second show the throughput of the whole machine and the
+// latency is the time of classifyImage for a single image.
+class ForestEvaluator
+{
+public:
+    explicit ForestEvaluator(const RandomDecisionForest &forest) : _forest(forest) {}
+
+    // Classify all depth images and compare them with the class images. The
+    // pose of each image is used to group the accuracy, it can be empty if
+    // all images belong to pose 0. Uses nthreads threads, 0 for the OpenMP
+    // default. Returns false if the sizes of the vectors do not match.
+    bool evaluate(const std::vector<cv::Mat> &classImages, const std::vector<cv::Mat> &depthImages,
+                  const std::vector<size_t> &poses = std::vector<size_t>(), size_t nthreads = 0);
+
+    const ConfusionMatrix & getConfusionMatrix() const { return _confusion; }
+
+    // Ratio of the correctly classified pixels to all pixels that the forest
+    // classified as the part of the hand.
+    double getAccuracy() const;
+    double getPoseAccuracy(size_t pose) const;
+    const std::map<size_t, std::pair<uint64_t, uint64_t>> & getPoseStats() const { return _poses; }
+
+    // Foreground pixels classified per second of the whole evaluation.
+    double getPixelsPerSecond() const;
+    // Time of classification of one image in seconds for the given percentile
+    // (0..100).
+    double getLatency(double percentile) const;
+
+    size_t getImagesNum() const { return _latencies.size(); }
+    uint64_t getPixelsNum() const { return _pixels; }
+
+    void print(std::ostream &out) const;
+
+private:
+    const RandomDecisionForest &_forest;
+    ConfusionMatrix _confusion = {};
+    // Matched and all classified pixels of each pose
+    std::map<size_t, std::pair<uint64_t, uint64_t>> _poses;
+    // Sorted times of the images
+    std::vector<double> _latencies;
+    uint64_t _pixels = 0;
+    double _seconds = 0.0;
+
+    static size_t toEvaluationClass(int8_t c);
+};
+
+inline size_t
+ForestEvaluator::toEvaluationClass(int8_t c)
+{
+    return (c < 0 || c >= grlHandIndexNum) ? grlEvaluationBackground : static_cast<size_t>(c);
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#ifdef USE_GPU
+#include <CL/cl.hpp>
+
+#include <grl/rdf/TrainingBackend.h>
+
+namespace grl {
+
+struct ForestTrainGPUContext
+{
+    cl::Device device;
+    cl::Context context;
+    // Must not be set by the main app - the tree will set it by itself
+    cl::Program program;
+    int maxImages;
+};
+
+// Backend running the kernels from rdf.cl. The pixels of the node are
+// uploaded once and the depth images are sent in batches of maxImages. The
+// kernels read the pixels in the layout of Pixel, so they are converted
+// before the upload.
+class OpenCLTrainingBackend : public TrainingBackend
+{
+public:
+    const char * getName() const override { return "OpenCL"; }
+
+    // Build rdf.cl for the device of the context. Must be called once,
+    // before any of the backends is created.
+    static bool buildProgram(ForestTrainGPUContext &gpuContext, std::string &error);
+
+    // Create the queue, kernels and buffers for up to maxPixels pixels.
+    bool init(const ForestTrainGPUContext &gpuContext, size_t maxPixels);
+
+    bool setNodePixels(const TrainingPixels &pixels,
+                       const std::vector<cv::Mat> &depthImages) override;
+
+    bool getClassCounts(const TrainingPixels &pixels, ClassCounts &counts) override;
+
+    bool evaluateDecision(const Decision &decision,
+                          const TrainingPixels &pixels,
+                          std::vector<uint8_t> &directions,
+                          ClassCounts &leftCounts) override;
+
+private:
+    cl::Context _context;
+    cl::CommandQueue _queue;
+    cl::Buffer _bufferAllPix;
+    cl::Buffer _bufferSplit;
+    cl::Buffer _bufferPix;
+    cl::Buffer _bufferPixCount;
+    cl::Kernel _getFeatureTrain;
+    cl::Kernel _getProbabilities;
+    int _maxImages = 0;
+    size_t _maxPixels = 0;
+
+    // Images used by the pixels of the node and the number of the pixels
+    // from each of them
+    std::vector<uint32_t> _imageIDs;
+    std::vector<int> _imagesPixelCount;
+    std::vector<float> _imageData;
+    std::vector<cl_char> _split;
+    // Pixels converted for the kernels
+    std::vector<Pixel> _pixels;
+    const std::vector<cv::Mat> *_depthImages = nullptr;
+
+    static void toPixels(const TrainingPixels &pixels, std::vector<Pixel> &dst);
+
+    bool checkError(cl_int err, const char *what);
+};
+
+}
+#endif // USE_GPU
@@ -2,6 +2,10 @@
 
 #include <grl/gesture/HandSkeleton.h>
 
+#include <functional>
+#include <string>
+#include <vector>
+
 namespace grl {
 
 enum HandClass {
@@ -95,13 +99,29 @@ typedef struct Pixel
 } Pixel;
 #endif
 
+// Called by the parallel loader for every loaded image. The images are passed
+// in the order of their imgID, as soon as the image and all images before it
+// are decoded. They are not yet aligned to the common size at this point.
+using ImageLoadedCallback = std::function<void(uint32_t imgID,
+                                               const cv::Mat &classImage,
+                                               const cv::Mat &depthImage)>;
+
 class RDFTools {
 public:
     static constexpr HandJointType handClassToHandJoint(HandClass handClass) {
         return handClassToJointMap[handClass];
     }
 
+    // Get the class of the 24-bit 0xRRGGBB color. grlUnknownIndex is returned
+    // for the colors which are not representing any class.
+    static int8_t rgbToHandClass(uint32_t rgb);
+
     static void convertRGBToHandClasses(const cv::Mat &src, cv::Mat &dst);
+    // Find the bounding box of the non-black pixels and convert it to the
+    // classes in a single pass over the RGB image. The dst contains only the
+    // area of the returned bounding box, which is the same as the one returned
+    // by getBoundingBoxRGB. If the image is empty, empty rect is returned.
+    static cv::Rect convertRGBToHandClassesCropped(const cv::Mat &src, cv::Mat &dst);
     static void convertHandClassesToRGB(const cv::Mat &src, cv::Mat &dst);
 
     static cv::Rect loadDepthImageWithClasses(
@@ -118,8 +138,57 @@ public:
         const std::string &depthName,
         std::vector<cv::Mat> &classImages,
         std::vector<cv::Mat> &depthImages);
+    // Same as loadDepthImagesWithClasses, but the images are decoded on the
+    // pool of nthreads threads (0 - use all hardware threads). The order of
+    // the images, so also their imgID, is the same as for the sequential
+    // loader. If onImageLoaded is set, it is called from the calling thread
+    // while the rest of the images is still being decoded. An exception thrown
+    // while decoding an image is rethrown before the image is passed on.
+    static void loadDepthImagesWithClassesParallel(
+        size_t start,
+        size_t stop,
+        size_t step,
+        uint8_t nameDigits,
+        const std::string &className,
+        const std::string &depthName,
+        std::vector<cv::Mat> &classImages,
+        std::vector<cv::Mat> &depthImages,
+        size_t nthreads = 0,
+        const ImageLoadedCallback &onImageLoaded = nullptr);
 
 private:
+    // Perfect hash table mapping the class colors to the class indices. The
+    // multiplier is chosen on the first use, so that there are no collisions
+    // between the colors of the classes.
+    struct ColorLookup
+    {
+        static constexpr int bits = 6;
+        static constexpr uint32_t emptyKey = 0xFFFFFFFF;
+
+        uint32_t multiplier;
+        std::array<uint32_t, 1 << bits> keys;
+        std::array<int8_t, 1 << bits> classes;
+
+        ColorLookup();
+
+        uint32_t hash(uint32_t rgb) const { return (rgb * multiplier) >> (32 - bits); }
+        int8_t operator()(uint32_t rgb) const
+        {
+            uint32_t h = hash(rgb);
+            return keys[h] == rgb ? classes[h] : static_cast<int8_t>(grlUnknownIndex);
+        }
+    };
+
+    static const ColorLookup & getColorLookup();
+
+    static std::string getImageName(const std::string &baseName, size_t i,
+                                    uint8_t nameDigits, const char *extension);
+    // Pad all images to the common size, which is the power of 2 of the
+    // biggest image (needed for GPU computing).
+    static void alignImagesToCommonSize(cv::Size sizeMax,
+                                        std::vector<cv::Mat> &classImages,
+                                        std::vector<cv::Mat> &depthImages);
+
     static void convertBlenderDepthToGeneric(const cv::Mat &src, cv::Mat &dst);
 
     static constexpr HandJointType handClassToJointMap[] = {
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "DecisionTree.h"
+#include "ForegroundSampler.h"
+#include "OpenCLTrainingBackend.h"
+#include "TrainingBackend.h"
+#include "TrainingMemory.h"
+#include "TrainingMetrics.h"
 
 #include <thread>
 #include <list>
@@ -8,28 +13,31 @@
 
 namespace grl {
 
-#ifdef USE_GPU
-struct ForestTrainGPUContext
-{
-    cl::Device device;
-    cl::Context context;
-    // Must not be set by the main app - the tree will set it by itself
-    cl::Program program;
-    int maxImages;
-};
-#endif
-
 struct ForestTrainContext
 {
-#ifdef USE_GPU
+    // Needed only by the OpenCL backend
     ForestTrainGPUContext *gpuContext;
-#endif
     size_t nthreads;
     size_t pixelsPerImage;
     int nodeTrainLimit;
     int maxDepth;
     std::vector<cv::Mat> classImages;
     std::vector<cv::Mat> depthImages;
+    // Draw the pixels of each image evenly from all classes present in it
+    bool stratifiedSampling = false;
+    TrainingBackendType backend = grlTrainingBackendAuto;
+    // Random generator of each tree is seeded with the seed and the index of
+    // the tree in the whole forest (firstTree + index in this forest), so
+    // the trees can be trained separately in several processes.
+    uint32_t seed = 0;
+    size_t firstTree = 0;
+    // Memory for the training pixels of all trees trained at the same time
+    // in bytes, 0 for no limit. The trees wait for their turn if their
+    // estimated peak does not fit into what is left.
+    size_t memoryBudget = 0;
+    // Receives the metrics of the trained trees and nodes. If not set, the
+    // trees are printed to the standard output.
+    TrainingMetrics *metrics = nullptr;
 };
 
 constexpr int grlBestPointsNum = 5;
@@ -43,29 +51,86 @@ class RandomDecisionForest
 public:
     RandomDecisionForest(size_t ntrees = 0);
 
+    size_t getSize() const { return _trees.size(); }
+
     DecisionTree & getTree(size_t i) { return _trees[i]; }
     const DecisionTree & getTree(size_t i) const { return _trees[i]; }
 
     DecisionTree & operator[](size_t i) { return _trees[i]; }
     const DecisionTree & operator[](size_t i) const { return _trees[i]; }
 
-    void train(const ForestTrainContext &context);
-
-    void saveToFile(const std::string &fileName);
+    // Train all trees. Returns false if the backend could not be created or
+    // failed during the training, the error is printed to stderr.
+    bool train(const ForestTrainContext &context);
+
+    // Train ntrees new trees and append them to the forest, the existing
+    // trees are not changed. The new trees are numbered after the existing
+    // ones, so they are not the same as the existing trees trained with the
+    // same seed. On failure the forest is left as it was.
+    bool appendTrees(size_t ntrees, const ForestTrainContext &context);
+
+    // Refit the probabilities in the leaves of all trees to the new labelled
+    // data in a single pass over its foreground pixels. The decisions are
+    // not changed, so it is much faster than training.
+    void refitLeaves(const std::vector<cv::Mat> &classImages,
+                     const std::vector<cv::Mat> &depthImages);
+
+    // The trees are numbered in the file starting from firstTree, which is
+    // the index of the first tree in the whole forest for partial forests.
+    // Peak memory used by the training data of the tree in bytes, 0 if the
+    // tree was not trained by this forest.
+    size_t getTrainingPeakMemory(size_t i) const { return i < _peakMemory.size() ? _peakMemory[i] : 0; }
+
+    // Save the trees to the file. Next to it, the index with the offsets of
+    // the trees is saved in fileName + ".idx", so they can be read in
+    // parallel.
+    void saveToFile(const std::string &fileName, size_t firstTree = 0);
+    // Load the trees. If there is a valid index for the file, the trees are
+    // parsed in parallel, otherwise one after another.
     bool loadFromFile(const std::string &fileName);
-
+    // Replace the trees with the ones from the partial forests. The trees are
+    // placed by their numbers, if more files contain the tree with the same
+    // number, the one from the later file is used. Returns false if any of
+    // the files cannot be read or some of the trees are missing.
+    bool mergeFromFiles(const std::vector<std::string> &fileNames);
+
+    // Classify all pixels of the image. Does not modify the forest, so many
+    // images can be classified by the same forest at the same time.
     void classifyImage(const cv::Mat &depthImage, cv::Mat &classImage, ClassesWeights &weights,
-        ClassesPoints &bestPoints);
+        ClassesPoints &bestPoints) const;
 
 private:
     std::vector<DecisionTree> _trees;
     std::vector<std::thread> _threads;
-
-    static void trainTree(DecisionTree *tree, const ForestTrainContext *context);
+    // Peak memory used by the training pixels of each tree in bytes
+    std::vector<size_t> _peakMemory;
+
+    // Train the trees starting from the first one.
+    bool trainTrees(size_t first, const ForestTrainContext &context);
+
+    // Read the trees numbered from firstTree.
+    static bool readTrees(const std::string &fileName, size_t &firstTree,
+                          std::vector<DecisionTree> &trees);
+    static bool readTreesSequential(const std::string &fileName, size_t &firstTree,
+                                    std::vector<DecisionTree> &trees);
+    static bool readTreesParallel(const std::string &fileName, size_t firstTree,
+                                  const std::vector<std::streamoff> &offsets,
+                                  std::vector<DecisionTree> &trees);
+
+    // Index of the file with the trees. It is valid only if the size and the
+    // checksum of the file are the same as when the index was saved.
+    static void saveIndex(const std::string &fileName, size_t firstTree,
+                          const std::vector<std::streamoff> &offsets);
+    static bool loadIndex(const std::string &fileName, size_t &firstTree,
+                          std::vector<std::streamoff> &offsets);
+
+    static void trainTree(DecisionTree *tree, size_t treeIndex, const ForestTrainContext *context,
+                          const std::vector<ForegroundSampler> *samplers, size_t npixels,
+                          TrainingMetrics *metrics, bool *result, size_t *peakMemory);
 
     std::pair<float, int8_t> getClassForPixel(const cv::Mat &depthImage,
                                               const Pixel &pixel,
-                                              std::vector<float> &probabilitiesSum);
+                                              std::vector<float> &probabilitiesSum) const;
 };
 
 inline
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace grl {
+
+// Counter-based random number generator. The n-th number of the stream is
+// the SplitMix64 hash of the key of the stream and n, so there is no state
+// passed between the numbers. Independent streams can be derived for every
+// tree, node or candidate decision and the results do not depend on the
+// order, in which they are used, or on the number of the threads.
+// The distributions are implemented here, because the ones from <random>
+// give different results in each standard library.
+class RandomStream
+{
+public:
+    using result_type = uint32_t;
+
+    explicit RandomStream(uint64_t seed = 0) : _key(mix(seed)) {}
+
+    // Get the independent stream with the given id, e.g. the index of a tree.
+    RandomStream getSubstream(uint64_t id) const;
+
+    // Jump to the n-th number of the stream.
+    void seek(uint64_t n) { _counter = n; }
+
+    result_type operator()() { return static_cast<result_type>(next() >> 32); }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    // Uniform integer from [0, n), n must be greater than 0.
+    uint32_t uniformIndex(uint32_t n);
+    // Uniform integer from [a, b].
+    int uniformInt(int a, int b);
+    // Uniform real number from [a, b).
+    float uniformReal(float a, float b);
+
+private:
+    uint64_t _key;
+    uint64_t _counter = 0;
+
+    static uint64_t mix(uint64_t x);
+    uint64_t next() { return mix(_key + ++_counter * 0x9E3779B97F4A7C15ull); }
+};
+
+inline uint64_t
+RandomStream::mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+inline RandomStream
+RandomStream::getSubstream(uint64_t id) const
+{
+    RandomStream stream;
+    stream._key = mix(_key ^ mix(id + 0x9E3779B97F4A7C15ull));
+    return stream;
+}
+
+inline uint32_t
+RandomStream::uniformIndex(uint32_t n)
+{
+    // Multiply and shift, the values which would make the result biased are
+    // rejected (Lemire's method)
+    uint64_t m = static_cast<uint64_t>((*this)()) * n;
+    uint32_t low = static_cast<uint32_t>(m);
+    if (low < n) {
+        uint32_t threshold = (0u - n) % n;
+        while (low < threshold) {
+            m = static_cast<uint64_t>((*this)()) * n;
+            low = static_cast<uint32_t>(m);
+        }
+    }
+
+    return static_cast<uint32_t>(m >> 32);
+}
+
+inline int
+RandomStream::uniformInt(int a, int b)
+{
+    uint32_t range = static_cast<uint32_t>(b) - static_cast<uint32_t>(a) + 1;
+    return static_cast<int>(static_cast<uint32_t>(a) + uniformIndex(range));
+}
+
+inline float
+RandomStream::uniformReal(float a, float b)
+{
+    // 24 bits fit into the mantissa of the float exactly
+    float unit = static_cast<float>((*this)() >> 8) * (1.0f / 16777216.0f);
+    return a + (b - a) * unit;
+}
+
+}
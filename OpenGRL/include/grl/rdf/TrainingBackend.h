@@ -0,0 +1,81 @@
+#pragma once
+
+#include <grl/rdf/Entropy.h>
+#include <grl/rdf/RDFUtils.h>
+#include <grl/rdf/TrainingPixels.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace grl {
+
+struct Decision;
+struct ForestTrainGPUContext;
+
+enum TrainingBackendType {
+    // Choose the fastest backend available on this machine
+    grlTrainingBackendAuto,
+    // Scalar CPU code parallelized with OpenMP
+    grlTrainingBackendCPU,
+    // CPU code evaluating blocks of 8 pixels with AVX2
+    grlTrainingBackendAVX2,
+    // OpenCL, available only if the library was built with USE_GPU
+    grlTrainingBackendOpenCL,
+};
+
+// Computations done for every node of the tree while it is being trained.
+// Each tree trained at the same time uses its own backend, so the backend
+// does not have to be thread safe. On error the methods return false and
+// the description can be obtained by getError().
+class TrainingBackend
+{
+public:
+    virtual ~TrainingBackend() = default;
+
+    virtual const char * getName() const = 0;
+
+    // Called once for the node, before any decision is evaluated on it.
+    virtual bool setNodePixels(const TrainingPixels &pixels,
+                               const std::vector<cv::Mat> &depthImages) = 0;
+
+    // Count the pixels of each class.
+    virtual bool getClassCounts(const TrainingPixels &pixels, ClassCounts &counts) = 0;
+
+    // Evaluate the decision for all pixels of the node. directions must be
+    // resized to the number of pixels and set to grlNodeGoLeft or
+    // grlNodeGoRight for every pixel. leftCounts are the class counts of the
+    // pixels going left.
+    virtual bool evaluateDecision(const Decision &decision,
+                                  const TrainingPixels &pixels,
+                                  std::vector<uint8_t> &directions,
+                                  ClassCounts &leftCounts) = 0;
+
+    const std::string & getError() const { return _error; }
+
+    // Check if the backend of the given type can be used on this machine.
+    static bool isAvailable(TrainingBackendType type);
+
+    // Create the backend. grlTrainingBackendAuto picks AVX2 if the CPU
+    // supports it and the scalar CPU backend otherwise. gpuContext is needed
+    // only for OpenCL and maxPixels is the size of the biggest node.
+    // Returns nullptr and sets the error if the backend cannot be created.
+    static std::unique_ptr<TrainingBackend> create(TrainingBackendType type,
+                                                   ForestTrainGPUContext *gpuContext,
+                                                   size_t maxPixels,
+                                                   std::string &error);
+
+protected:
+    std::string _error;
+
+    bool setError(const std::string &error);
+};
+
+inline bool
+TrainingBackend::setError(const std::string &error)
+{
+    _error = error;
+    return false;
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace grl {
+
+// Accounts the memory used by the training data of one tree - the pixels of
+// the open nodes and the directions of the evaluated candidates. Used only
+// by the thread training the tree.
+class TreeMemoryTracker
+{
+public:
+    void allocate(size_t bytes);
+    void release(size_t bytes);
+
+    size_t getCurrent() const { return _current; }
+    size_t getPeak() const { return _peak; }
+
+private:
+    size_t _current = 0;
+    size_t _peak = 0;
+};
+
+inline void
+TreeMemoryTracker::allocate(size_t bytes)
+{
+    _current += bytes;
+    _peak = std::max(_peak, _current);
+}
+
+inline void
+TreeMemoryTracker::release(size_t bytes)
+{
+    assert(bytes <= _current);
+    _current -= bytes;
+}
+
+// Limits the memory used by the trees trained at the same time. Before the
+// tree is started, its estimated peak is reserved and the thread waits until
+// there is enough of the budget left. The tree bigger than the whole budget
+// is started only if nothing else is running, so the training never blocks
+// forever.
+class TrainingMemoryBudget
+{
+public:
+    // Budget of 0 means no limit.
+    explicit TrainingMemoryBudget(size_t budget) : _budget(budget) {}
+
+    void acquire(size_t bytes);
+    void release(size_t bytes);
+
+    size_t getBudget() const { return _budget; }
+
+    // Estimate the peak memory used by the tree trained on npixels pixels.
+    // When the node is split, its pixels, the pixels of both children and
+    // the directions of the best and the evaluated candidate are alive. The
+    // pixels of the other open nodes are disjoint with the split node, so
+    // all together they never exceed the pixels of the root.
+    static size_t estimateTreePeak(size_t npixels);
+
+private:
+    size_t _budget;
+    size_t _reserved = 0;
+    std::mutex _mutex;
+    std::condition_variable _released;
+};
+
+// Get the peak resident set size of the process in bytes, 0 if unknown.
+size_t getProcessPeakRSS();
+
+}
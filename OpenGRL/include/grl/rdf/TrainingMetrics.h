@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace grl {
+
+enum TrainingVerbosity {
+    // Nothing is printed, the records are only written to the stream
+    grlTrainingVerbosityQuiet,
+    // Line for each trained tree and the summary of the depths
+    grlTrainingVerbosityTrees,
+    // Line for each node as well
+    grlTrainingVerbosityNodes,
+};
+
+enum TrainingMetricsFormat {
+    // Header and one line for each record
+    grlTrainingMetricsCSV,
+    // One JSON object in each line
+    grlTrainingMetricsJSON,
+};
+
+// Training of one node of the tree.
+struct NodeMetrics
+{
+    // Heap index of the node, root is 1
+    uint64_t nodeID;
+    int depth;
+    size_t pixels;
+    // 0 for the leaves
+    int candidates;
+    // Information gain of the chosen decision, NaN if the node is a leaf
+    double gain;
+    double seconds;
+
+    // Evaluations of the decision for one pixel per second.
+    double getEvaluationsPerSecond() const;
+};
+
+// Totals of one tree.
+struct TreeMetrics
+{
+    size_t tree;
+    const char *backend;
+    size_t pixels;
+    size_t nodes;
+    size_t leaves;
+    int depth;
+    uint64_t evaluations;
+    double seconds;
+    size_t peakMemory;
+};
+
+// Collects the metrics of the trained trees. The trees report their nodes
+// once they are trained, so nothing is printed or written while the tree is
+// being trained and the threads training the trees do not wait for each
+// other on every node. Records are printed depending on the verbosity and
+// can be also written to the file as CSV or JSON.
+class TrainingMetrics
+{
+public:
+    explicit TrainingMetrics(TrainingVerbosity verbosity = grlTrainingVerbosityTrees,
+                             std::ostream &log = std::cout);
+
+    // Write all records to the file as well. Returns false if the file
+    // cannot be opened.
+    bool openStream(const std::string &fileName, TrainingMetricsFormat format);
+
+    TrainingVerbosity getVerbosity() const { return _verbosity; }
+    std::ostream & getLog() { return _log; }
+
+    // Add the trained tree and its nodes. Can be called from many threads.
+    void addTree(const TreeMetrics &tree, const std::vector<NodeMetrics> &nodes);
+
+    // Totals of all nodes at the given depth of all trees.
+    struct DepthTotals
+    {
+        size_t nodes = 0;
+        size_t pixels = 0;
+        uint64_t evaluations = 0;
+        double seconds = 0.0;
+    };
+    std::vector<DepthTotals> getDepthTotals() const;
+
+    // Print time spent at each depth, so it is visible which depths dominate
+    // the training.
+    void printDepthSummary();
+
+private:
+    TrainingVerbosity _verbosity;
+    std::ostream &_log;
+    std::ofstream _stream;
+    TrainingMetricsFormat _format = grlTrainingMetricsCSV;
+    // Index is depth - 1
+    std::vector<DepthTotals> _depths;
+    mutable std::mutex _mutex;
+
+    void writeNode(size_t tree, const NodeMetrics &node);
+    void writeTree(const TreeMetrics &tree);
+};
+
+inline double
+NodeMetrics::getEvaluationsPerSecond() const
+{
+    return seconds > 0.0 ? static_cast<double>(candidates) * pixels / seconds : 0.0;
+}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <grl/rdf/RDFUtils.h>
+
+#include <cassert>
+#include <vector>
+
+namespace grl {
+
+// Pixels used for training the tree, stored as separate arrays, so the
+// evaluation of the decision reads only the fields it needs and the arrays
+// can be loaded directly into the vector registers. Instead of the depth,
+// its reciprocal is stored, so the offsets are scaled by multiplication.
+// The image of each pixel is resolved to the pointer to its data. All of
+// the depth images must be CV_32FC1 of the same size.
+class TrainingPixels
+{
+public:
+    static constexpr size_t bytesPerPixel = 2 * sizeof(int16_t) + sizeof(float) +
+        sizeof(const float *) + sizeof(uint32_t) + sizeof(int8_t);
+
+    // Set size of the images and their row stride (in floats).
+    void setGeometry(int cols, int rows, size_t stride);
+    // Copy the geometry of the images from other store.
+    void setGeometry(const TrainingPixels &other);
+
+    void reserve(size_t n);
+    void clear();
+    size_t size() const { return _x.size(); }
+    bool empty() const { return _x.empty(); }
+    // Memory allocated for the pixels in bytes.
+    size_t getMemorySize() const { return _x.capacity() * bytesPerPixel; }
+
+    void push_back(int16_t x, int16_t y, float depth, const float *image,
+                   uint32_t imgID, int8_t classIndex);
+
+    // Distribute the pixels to left and right, keeping their order.
+    void partition(const std::vector<uint8_t> &directions, uint8_t leftDirection,
+                   TrainingPixels &left, TrainingPixels &right) const;
+
+    int getCols() const { return _cols; }
+    int getRows() const { return _rows; }
+    size_t getStride() const { return _stride; }
+
+    const int16_t * getX() const { return _x.data(); }
+    const int16_t * getY() const { return _y.data(); }
+    const float * getInvDepth() const { return _invDepth.data(); }
+    const float * const * getImages() const { return _images.data(); }
+    const uint32_t * getImageIDs() const { return _imageIDs.data(); }
+    const int8_t * getClasses() const { return _classes.data(); }
+
+private:
+    int _cols = 0;
+    int _rows = 0;
+    size_t _stride = 0;
+
+    std::vector<int16_t> _x;
+    std::vector<int16_t> _y;
+    std::vector<float> _invDepth;
+    std::vector<const float *> _images;
+    // Needed only by the backends working on the copies of the images
+    std::vector<uint32_t> _imageIDs;
+    std::vector<int8_t> _classes;
+};
+
+inline void
+TrainingPixels::setGeometry(int cols, int rows, size_t stride)
+{
+    _cols = cols;
+    _rows = rows;
+    _stride = stride;
+}
+
+inline void
+TrainingPixels::setGeometry(const TrainingPixels &other)
+{
+    setGeometry(other._cols, other._rows, other._stride);
+}
+
+inline void
+TrainingPixels::push_back(int16_t x, int16_t y, float depth, const float *image,
+                          uint32_t imgID, int8_t classIndex)
+{
+    _x.push_back(x);
+    _y.push_back(y);
+    _invDepth.push_back(1.0f / depth);
+    _images.push_back(image);
+    _imageIDs.push_back(imgID);
+    _classes.push_back(classIndex);
+}
+
+}
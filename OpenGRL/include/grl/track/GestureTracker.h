@@ -74,6 +74,11 @@ public:
      */
     void init(const TrackerConfig &config);
 
+    /**
+     * Get the config with which the tracker was initialized.
+     */
+    const TrackerConfig & getConfig() const { return _config; }
+
     void clear();
 
     /**
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace grl {
+
+/**
+ * Pool of the objects which are reused between the calls, like the buffers
+ * or the helper objects keeping the storage. Each thread leases its own
+ * object, so the calls can run at the same time, and the objects are created
+ * only when all of the existing ones are leased.
+ */
+template<typename T>
+class ObjectPool
+{
+public:
+    /**
+     * Object leased from the pool. It is returned to the pool when the lease
+     * is destroyed.
+     */
+    class Lease
+    {
+    public:
+        Lease(ObjectPool &pool, std::unique_ptr<T> object) : _pool(&pool), _object(std::move(object)) {}
+        Lease(Lease &&other) = default;
+        ~Lease();
+
+        Lease(const Lease &) = delete;
+        Lease & operator=(const Lease &) = delete;
+
+        T & operator*() const { return *_object; }
+        T * operator->() const { return _object.get(); }
+
+    private:
+        ObjectPool *_pool;
+        std::unique_ptr<T> _object;
+    };
+
+    /**
+     * Lease the object from the pool. If there is no free object, the new one
+     * is created.
+     *
+     * @returns lease of the object.
+     */
+    Lease acquire();
+
+private:
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<T> > _free;
+
+    void release(std::unique_ptr<T> object);
+};
+
+template<typename T>
+inline
+ObjectPool<T>::Lease::~Lease()
+{
+    if (_object)
+        _pool->release(std::move(_object));
+}
+
+template<typename T>
+inline typename ObjectPool<T>::Lease
+ObjectPool<T>::acquire()
+{
+    std::unique_ptr<T> object;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_free.empty()) {
+            object = std::move(_free.back());
+            _free.pop_back();
+        }
+    }
+
+    if (!object)
+        object = std::make_unique<T>();
+
+    return Lease(*this, std::move(object));
+}
+
+template<typename T>
+inline void
+ObjectPool<T>::release(std::unique_ptr<T> object)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _free.push_back(std::move(object));
+}
+
+}
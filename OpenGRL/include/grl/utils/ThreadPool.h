@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace grl {
+
+/**
+ * Simple pool of persistent worker threads. Tasks are executed in the order
+ * in which they were enqueued, but there is no guarantee which thread will
+ * execute them and in what order they will finish.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * Create the pool and start the workers.
+     *
+     * @param nthreads number of the worker threads. If 0 is passed, the number
+     * of the hardware threads is used.
+     */
+    explicit ThreadPool(size_t nthreads = 0);
+
+    /**
+     * Wait for all enqueued tasks to finish and join the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    /**
+     * Enqueue the task for the execution by one of the workers.
+     *
+     * @param task callable object without arguments.
+     * @returns future, which can be used to wait for the result of the task.
+     */
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> enqueue(F &&task);
+
+    /**
+     * Call fun(i) for every i in the range [0, n) using the workers and wait
+     * until all of the calls are finished. The indices are distributed
+     * dynamically, so the calls with uneven cost are balanced.
+     *
+     * @param n number of the indices.
+     * @param fun callable object taking size_t as an argument.
+     */
+    template<typename F>
+    void parallelFor(size_t n, F fun);
+
+    /**
+     * Get number of the worker threads.
+     *
+     * @returns number of the worker threads.
+     */
+    size_t getSize() const { return _workers.size(); }
+
+private:
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()> > _tasks;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stop = false;
+
+    void work();
+};
+
+inline
+ThreadPool::ThreadPool(size_t nthreads)
+{
+    if (nthreads == 0)
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+    _workers.reserve(nthreads);
+    for (size_t i = 0; i < nthreads; ++i)
+        _workers.emplace_back(&ThreadPool::work, this);
+}
+
+inline
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+
+    for (auto it = _workers.begin(); it != _workers.end(); ++it)
+        it->join();
+}
+
+template<typename F>
+std::future<typename std::result_of<F()>::type>
+ThreadPool::enqueue(F &&task)
+{
+    using Result = typename std::result_of<F()>::type;
+
+    // std::function must be copyable, so the packaged task is shared
+    auto packaged = std::make_shared<std::packaged_task<Result()> >(std::forward<F>(task));
+    std::future<Result> result = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push([packaged]() { (*packaged)(); });
+    }
+    _condition.notify_one();
+
+    return result;
+}
+
+template<typename F>
+void
+ThreadPool::parallelFor(size_t n, F fun)
+{
+    auto next = std::make_shared<std::atomic<size_t> >(0);
+    size_t nworkers = std::min(n, _workers.size());
+
+    std::vector<std::future<void> > done;
+    done.reserve(nworkers);
+    for (size_t i = 0; i < nworkers; ++i) {
+        done.push_back(enqueue([next, n, &fun]() {
+            for (size_t index = (*next)++; index < n; index = (*next)++)
+                fun(index);
+        }));
+    }
+
+    // get() rethrows the exception if any of the calls failed
+    for (auto it = done.begin(); it != done.end(); ++it)
+        it->get();
+}
+
+inline void
+ThreadPool::work()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+            if (_stop && _tasks.empty())
+                return;
+            task = std::move(_tasks.front());
+            _tasks.pop();
+        }
+        task();
+    }
+}
+
+}
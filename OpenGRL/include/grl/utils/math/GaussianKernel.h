@@ -41,6 +41,16 @@ public:
      */
     const float & operator()(int x, int y) const;
 
+    /**
+     * Get value of the 1D kernel, of which the 2D kernel is made. The value of
+     * the 2D kernel at (x, y) is the product of the values at x and at y, so
+     * the filtering can be split into the rows and the columns.
+     *
+     * @param i coordinate in the kernel.
+     * @returns value in the 1D kernel.
+     */
+    float getProfile(int i) const;
+
      /**
      * Get size of the kernel
      *
@@ -50,6 +60,7 @@ public:
 
 private:
     std::vector<float> _mask;
+    std::vector<float> _profile;
     size_t _n;
 };
 
@@ -63,6 +74,10 @@ inline const float & GaussianKernel::operator()(int x, int y) const
     return _mask[x + y * _n];
 }
 
+inline float GaussianKernel::getProfile(int i) const
+{
+    return _profile[i];
+}
 
 inline size_t GaussianKernel::getSize() const
 {
@@ -3,6 +3,14 @@
 #include "Vectors.h"
 #include "Ranges.h"
 
+#include <cstdint>
+
+// SSE2 is always available on x64
+#if defined(_M_X64) || defined(__SSE2__)
+#define GRL_PLANE_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace grl {
 
 /**
@@ -50,6 +58,21 @@ struct Plane
      */
     bool isOnPlane(Vec3f point);
 
+    /**
+     * Classify the run of the depth image pixels against the plane. Pixel i of
+     * the run is the point (xBegin + i, y, depths[i]) and its mask value is 1
+     * if the point is in front of or on the plane, 0 if it is behind it.
+     * The result is the same as comparing operator() with 0 for each point,
+     * but 4 pixels are evaluated at once where SSE2 is available.
+     *
+     * @param xBegin x coordinate of the first pixel of the run.
+     * @param y y coordinate of all pixels of the run.
+     * @param depths depths of the pixels.
+     * @param count number of the pixels in the run.
+     * @param mask output array of count values.
+     */
+    void classify(int xBegin, int y, const uint16_t *depths, int count, uint8_t *mask) const;
+
     /**
      * Create plane using three points that are supposed to be lying on it.
      *
@@ -106,6 +129,54 @@ inline bool Plane::isOnPlane(Vec3f point)
     return absBetween(operator()(point), epsilon);
 }
 
+inline void Plane::classify(int xBegin, int y, const uint16_t *depths, int count, uint8_t *mask) const
+{
+    // Terms are added in the same order as in the dot product, so the results
+    // do not differ from operator()
+    const float rowTerm = _normal.y * (static_cast<float>(y) - _p0.y);
+    int i = 0;
+
+#ifdef GRL_PLANE_SSE2
+    const __m128 normalX = _mm_set1_ps(_normal.x);
+    const __m128 normalZ = _mm_set1_ps(_normal.z);
+    const __m128 originX = _mm_set1_ps(_p0.x);
+    const __m128 originZ = _mm_set1_ps(_p0.z);
+    const __m128 row = _mm_set1_ps(rowTerm);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i x = _mm_add_epi32(_mm_set1_epi32(xBegin), _mm_setr_epi32(0, 1, 2, 3));
+    const __m128i step = _mm_set1_epi32(4);
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i depth16 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(depths + i));
+        __m128 depthLo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(depth16, _mm_setzero_si128()));
+        __m128 depthHi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(depth16, _mm_setzero_si128()));
+        __m128 xLo = _mm_cvtepi32_ps(x);
+        x = _mm_add_epi32(x, step);
+        __m128 xHi = _mm_cvtepi32_ps(x);
+        x = _mm_add_epi32(x, step);
+
+        __m128 valueLo = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, _mm_sub_ps(xLo, originX)), row),
+                                    _mm_mul_ps(normalZ, _mm_sub_ps(depthLo, originZ)));
+        __m128 valueHi = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, _mm_sub_ps(xHi, originX)), row),
+                                    _mm_mul_ps(normalZ, _mm_sub_ps(depthHi, originZ)));
+
+        // All bits of the lane are set for the points in front, they are
+        // packed to the bytes and reduced to 1
+        __m128i inFront = _mm_packs_epi32(_mm_castps_si128(_mm_cmpge_ps(valueLo, zero)),
+                                          _mm_castps_si128(_mm_cmpge_ps(valueHi, zero)));
+        inFront = _mm_and_si128(_mm_packs_epi16(inFront, inFront), one);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(mask + i), inFront);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        float value = _normal.x * (static_cast<float>(xBegin + i) - _p0.x) + rowTerm +
+                      _normal.z * (static_cast<float>(depths[i]) - _p0.z);
+        mask[i] = value >= 0.0f ? 1 : 0;
+    }
+}
+
 inline Vec3f Plane::getNormal() const
 {
     return _normal;
@@ -296,6 +296,11 @@ KinectCamera::getSkeletons(Skeletons *skeletons)
             //	continue;
 
             Skeleton skeleton;
+            UINT64 trackingId;
+            hr = body->get_TrackingId(&trackingId);
+            if (FAILED(hr))
+                continue;
+            skeleton.id = trackingId;
             //skeleton.lean = std::max(abs(lean.X), abs(lean.Y)); // Get maximum absolute lean
 
             // Todo: test lean parameter and do not add object if it is too high
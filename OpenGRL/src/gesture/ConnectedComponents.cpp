@@ -0,0 +1,252 @@
+#include <grl/gesture/ConnectedComponents.h>
+
+namespace grl {
+
+void ConnectedComponents::label(const cv::Mat &depthImage, int tolerance, int nstripes)
+{
+    // Make sure that this is depth image.
+    assert(depthImage.type() == CV_16UC1);
+
+    _depthImage = depthImage;
+    _tolerance = tolerance;
+    int width = depthImage.cols;
+    int height = depthImage.rows;
+    size_t pixelsNum = static_cast<size_t>(width) * height;
+    // The storage is reused between the frames
+    _parents.resize(pixelsNum);
+    _labels.resize(pixelsNum);
+    _pixels.resize(pixelsNum);
+
+    // Created on the first frame, the workers are kept for the next ones
+    if (!_workers)
+        _workers = std::make_unique<ThreadPool>();
+    if (nstripes <= 0)
+        nstripes = static_cast<int>(_workers->getSize());
+    nstripes = clampMax(nstripes, clampMin(height, 1));
+
+    // Each stripe is using only the pixels of its own rows, so the stripes
+    // do not share anything until they are joined
+    _workers->parallelFor(static_cast<size_t>(nstripes), [&](size_t stripe) {
+        int index = static_cast<int>(stripe);
+        labelStripe(height * index / nstripes, height * (index + 1) / nstripes, tolerance);
+    });
+
+    for (int stripe = 1; stripe < nstripes; ++stripe) {
+        int y = height * stripe / nstripes;
+        if (y > 0 && y < height)
+            uniteRows(y, tolerance);
+    }
+
+    // The root of each set is its first pixel, so the components are numbered
+    // in the order of the pixels
+    std::vector<uint32_t> sizes;
+    for (uint32_t pixel = 0; pixel < pixelsNum; ++pixel) {
+        uint32_t root = find(pixel);
+        if (root == pixel) {
+            _labels[pixel] = static_cast<uint32_t>(sizes.size());
+            sizes.push_back(0);
+        } else {
+            _labels[pixel] = _labels[root];
+        }
+        ++sizes[_labels[pixel]];
+    }
+
+    // Group the pixels by the components, keeping them row by row
+    _componentBegin.resize(sizes.size() + 1);
+    _componentBegin[0] = 0;
+    for (size_t component = 0; component < sizes.size(); ++component)
+        _componentBegin[component + 1] = _componentBegin[component] + sizes[component];
+
+    std::vector<uint32_t> next(_componentBegin.begin(), _componentBegin.end() - 1);
+    for (uint32_t pixel = 0; pixel < pixelsNum; ++pixel)
+        _pixels[next[_labels[pixel]]++] = pixel;
+}
+
+bool ConnectedComponents::extractObject(Vec2i startingPoint, Plane plane, DepthObject &object) const
+{
+    return extractObject(startingPoint, plane, cv::Rect(0, 0, _depthImage.cols, _depthImage.rows), object);
+}
+
+bool ConnectedComponents::extractObject(Vec2i startingPoint, Plane plane, const cv::Rect &region,
+                                        DepthObject &object) const
+{
+    object.reset();
+
+    cv::Rect clipped = region & cv::Rect(0, 0, _depthImage.cols, _depthImage.rows);
+    if (!clipped.contains(cv::Point(startingPoint.x, startingPoint.y)))
+        return false;
+
+    // If the first pixel is behind the plane, skip extraction of the object
+    uint8_t startInFront;
+    plane.classify(startingPoint.x, startingPoint.y,
+                   _depthImage.ptr<uint16_t>(startingPoint.y) + startingPoint.x, 1, &startInFront);
+    if (!startInFront)
+        return false;
+
+    uint32_t component = getComponent(startingPoint.x, startingPoint.y);
+    int width = _depthImage.cols;
+    int xEnd = clipped.x + clipped.width - 1;
+    int yEnd = clipped.y + clipped.height - 1;
+
+    ObjectPool<Extraction>::Lease extraction = _extractions.acquire();
+    VisitedMap &usedMap = extraction->usedMap;
+    std::vector<Span> &spans = extraction->spans;
+    size_t regionSize = static_cast<size_t>(clipped.width) * clipped.height;
+    usedMap.resize(regionSize);
+    usedMap.clear();
+    extraction->inFront.resize(regionSize);
+    extraction->classifiedRows.resize(static_cast<size_t>(clipped.height));
+    extraction->classifiedRows.clear();
+    spans.clear();
+
+    auto getIndex = [&](int x, int y) {
+        return static_cast<size_t>(x - clipped.x) + static_cast<size_t>(y - clipped.y) * clipped.width;
+    };
+
+    // Get the mask of the pixels in front of the plane for the row, indexed
+    // by the x coordinate. The row is classified when it is reached for the
+    // first time.
+    auto getInFrontRow = [&](int y) {
+        uint8_t *inFront = extraction->inFront.data() + getIndex(clipped.x, y);
+        size_t rowIndex = static_cast<size_t>(y - clipped.y);
+        if (!extraction->classifiedRows.isVisited(rowIndex)) {
+            plane.classify(clipped.x, y, _depthImage.ptr<uint16_t>(y) + clipped.x, clipped.width, inFront);
+            extraction->classifiedRows.visit(rowIndex);
+        }
+        return inFront - clipped.x;
+    };
+
+    // The pixel can be added only if it is from the component of the starting
+    // point, was not used yet and is in front of the plane
+    auto isFree = [&](int x, int y, const uint32_t *labels, const uint8_t *inFront) {
+        return labels[x] == component && !usedMap.isVisited(getIndex(x, y)) && inFront[x];
+    };
+
+    // Grow the run to the left and to the right from the pixel, which is
+    // already marked as used, and put it into the object
+    auto fillRun = [&](int x, int y) {
+        const uint16_t *row = _depthImage.ptr<uint16_t>(y);
+        const uint32_t *labels = _labels.data() + static_cast<size_t>(y) * width;
+        const uint8_t *inFront = getInFrontRow(y);
+        Span span = { y, x, x };
+        while (span.x0 > clipped.x) {
+            int nx = span.x0 - 1;
+            if (!isFree(nx, y, labels, inFront) ||
+                !absBetween(static_cast<int>(row[nx]) - row[span.x0], _tolerance))
+                break;
+            usedMap.visit(getIndex(nx, y));
+            span.x0 = nx;
+        }
+        while (span.x1 < xEnd) {
+            int nx = span.x1 + 1;
+            if (!isFree(nx, y, labels, inFront) ||
+                !absBetween(static_cast<int>(row[nx]) - row[span.x1], _tolerance))
+                break;
+            usedMap.visit(getIndex(nx, y));
+            span.x1 = nx;
+        }
+
+        object.putSpan(span.x0, y, row + span.x0, span.x1 - span.x0 + 1);
+        return span;
+    };
+
+    usedMap.visit(getIndex(startingPoint.x, startingPoint.y));
+    spans.push_back(fillRun(startingPoint.x, startingPoint.y));
+
+    // Same scanline fill as in the FloodFillClipped, the pixels of the other
+    // components are skipped by their label before the depths are compared
+    while (!spans.empty()) {
+        Span span = spans.back();
+        spans.pop_back();
+
+        const uint16_t *row = _depthImage.ptr<uint16_t>(span.y);
+        for (int ny = span.y - 1; ny <= span.y + 1; ny += 2) {
+            if (ny < clipped.y || ny > yEnd)
+                continue;
+
+            const uint16_t *neighbourRow = _depthImage.ptr<uint16_t>(ny);
+            const uint32_t *labels = _labels.data() + static_cast<size_t>(ny) * width;
+            const uint8_t *inFront = getInFrontRow(ny);
+            int nxEnd = clampMax(span.x1 + 1, xEnd);
+            for (int nx = clampMin(span.x0 - 1, clipped.x); nx <= nxEnd; ++nx) {
+                if (!isFree(nx, ny, labels, inFront))
+                    continue;
+
+                bool connected = false;
+                int xLast = clampMax(nx + 1, span.x1);
+                for (int x = clampMin(nx - 1, span.x0); x <= xLast && !connected; ++x)
+                    connected = absBetween(static_cast<int>(neighbourRow[nx]) - row[x], _tolerance);
+                if (!connected)
+                    continue;
+
+                usedMap.visit(getIndex(nx, ny));
+                Span next = fillRun(nx, ny);
+                spans.push_back(next);
+                // Pixels of the new run are already used
+                nx = next.x1;
+            }
+        }
+    }
+
+    return true;
+}
+
+uint32_t ConnectedComponents::find(uint32_t pixel)
+{
+    while (_parents[pixel] != pixel) {
+        // Path halving, every other pixel on the path points to its grandparent
+        _parents[pixel] = _parents[_parents[pixel]];
+        pixel = _parents[pixel];
+    }
+
+    return pixel;
+}
+
+void ConnectedComponents::unite(uint32_t first, uint32_t second)
+{
+    uint32_t firstRoot = find(first);
+    uint32_t secondRoot = find(second);
+    if (firstRoot < secondRoot)
+        _parents[secondRoot] = firstRoot;
+    else if (secondRoot < firstRoot)
+        _parents[firstRoot] = secondRoot;
+}
+
+void ConnectedComponents::labelStripe(int yBegin, int yEnd, int tolerance)
+{
+    int width = _depthImage.cols;
+    for (int y = yBegin; y < yEnd; ++y) {
+        const uint16_t *row = _depthImage.ptr<uint16_t>(y);
+        uint32_t rowBegin = static_cast<uint32_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            uint32_t pixel = rowBegin + x;
+            _parents[pixel] = pixel;
+
+            // Only the neighbours which were already visited - the left one
+            // and the ones in the row above, if it is in the stripe
+            if (x > 0 && absBetween(static_cast<int>(row[x]) - row[x - 1], tolerance))
+                unite(pixel, pixel - 1);
+        }
+
+        if (y > yBegin)
+            uniteRows(y, tolerance);
+    }
+}
+
+void ConnectedComponents::uniteRows(int y, int tolerance)
+{
+    int width = _depthImage.cols;
+    const uint16_t *row = _depthImage.ptr<uint16_t>(y);
+    const uint16_t *rowAbove = _depthImage.ptr<uint16_t>(y - 1);
+    uint32_t rowBegin = static_cast<uint32_t>(y) * width;
+    for (int x = 0; x < width; ++x) {
+        int depth = row[x];
+        int xEnd = clampMax(x + 1, width - 1);
+        for (int nx = clampMin(x - 1, 0); nx <= xEnd; ++nx) {
+            if (absBetween(static_cast<int>(rowAbove[nx]) - depth, tolerance))
+                unite(rowBegin + x, rowBegin - width + nx);
+        }
+    }
+}
+
+}
@@ -1,49 +1,35 @@
 #include <grl/gesture/FloodFillClipped.h>
-#include <queue>
 
 namespace grl {
 
-//////////////////////////////////////////////////
-// FFVoxel
-//////////////////////////////////////////////////
-
-FFVoxel::FFVoxel(int x, int y, int z)
-{
-    coords = Vec3i(x, y, z);
-}
-
 //////////////////////////////////////////////////
 // VoxelArray2D
 //////////////////////////////////////////////////
 
-VoxelArray2D::~VoxelArray2D()
-{
-    destroy();
-}
-
-FFVoxel & VoxelArray2D::operator()(int x, int y)
+void VoxelArray2D::setVoxelValue(int x, int y, int value)
 {
-    return getVoxel(x, y);
+    _depth[getIndex(x, y)] = static_cast<uint16_t>(value);
 }
 
-FFVoxel & VoxelArray2D::getVoxel(int x, int y)
+int VoxelArray2D::getNeighboursNumber(int x, int y) const
 {
-    return _voxels[x + y * _width];
+    int neighboursNumber = 0;
+    forEachNeighbour(x, y, [&neighboursNumber](int, int) { ++neighboursNumber; });
+    return neighboursNumber;
 }
 
-const FFVoxel & VoxelArray2D::getVoxel(int x, int y) const
+Voxel VoxelArray2D::getNeighbour(int x, int y, int i) const
 {
-    return _voxels[x + y * _width];
-}
+    assert(i < getNeighboursNumber(x, y));
 
-int VoxelArray2D::getVoxelValue(int x, int y) const
-{
-    return getVoxel(x, y).coords.z;
-}
+    Voxel neighbour;
+    int n = 0;
+    forEachNeighbour(x, y, [&](int nx, int ny) {
+        if (n++ == i)
+            neighbour = getVoxel(nx, ny);
+    });
 
-void VoxelArray2D::setVoxelValue(int x, int y, int value)
-{
-    getVoxel(x, y).coords.z = value;
+    return neighbour;
 }
 
 void VoxelArray2D::getSize(int &width, int &height) const
@@ -54,84 +40,50 @@ void VoxelArray2D::getSize(int &width, int &height) const
 
 void VoxelArray2D::destroy()
 {
-    delete _voxels;
-    _voxels = nullptr;
+    _depth.clear();
+    _depth.shrink_to_fit();
+    _x = 0;
+    _y = 0;
+    _width = 0;
+    _height = 0;
 }
 
 bool VoxelArray2D::init(int width, int height)
 {
-    // To prevent any leaks, call destroy just in case
-    destroy();
-
-    _voxels = new FFVoxel[width*height];
-    if (_voxels == nullptr)
-        return false;
-
+    _x = 0;
+    _y = 0;
     _width = width;
     _height = height;
-
-    // Initialize every voxel in the structure
-    FFVoxel *voxel = _voxels;
-    for (int h = 0; h < height; ++h) {
-        for (int w = 0; w < width; ++w, ++voxel) {
-            *voxel = FFVoxel(w, h, 0);
-
-            // Fill neighbours array
-            voxel->neighboursNumber = 0;
-            for (int y = clampMin(h - 1, 0); y <= clampMax(h + 1, height - 1); ++y) {
-                for (int x = clampMin(w - 1, 0); x <= clampMax(w + 1, width - 1); ++x) {
-                    // Make sure it is not the same voxel
-                    if (y != h || x != w)
-                        voxel->neighbours[voxel->neighboursNumber++] = &getVoxel(x, y);
-                }
-            }
-        }
-    }
+    // All adjacent voxels are the neighbours
+    _tolerance = INT_MAX;
+    _depth.assign(static_cast<size_t>(width) * height, 0);
 
     return true;
 }
 
 bool VoxelArray2D::fromImage(const cv::Mat &image, int tolerance)
+{
+    return fromImage(image, tolerance, cv::Rect(0, 0, image.cols, image.rows));
+}
+
+bool VoxelArray2D::fromImage(const cv::Mat &image, int tolerance, const cv::Rect &region)
 {
     // Make sure that this is depth image.
     assert(image.type() == CV_16UC1);
 
-    // To prevent any leaks, call destroy just in case
-    destroy();
-
-    _voxels = new FFVoxel[image.rows * image.cols];
-    if (_voxels == nullptr)
-        return false;
+    cv::Rect clipped = region & cv::Rect(0, 0, image.cols, image.rows);
+    _x = clipped.x;
+    _y = clipped.y;
+    _width = clipped.width;
+    _height = clipped.height;
+    _tolerance = tolerance;
+    // The storage is reused between the frames, it only grows
+    _depth.resize(static_cast<size_t>(_width) * _height);
 
-    _width = image.cols;
-    _height = image.rows;
-
-    // Initialize every voxel in the structure
-    FFVoxel *voxel = _voxels;
-    // Access the image data as a raw data
-    const uint16_t *dataStart = reinterpret_cast<const uint16_t *>(image.data);
-    const uint16_t *pixel = reinterpret_cast<const uint16_t *>(image.data);
-    for (int h = 0; h < image.rows; ++h) {
-        for (int w = 0; w < image.cols; ++w, ++voxel, ++pixel) {
-            *voxel = FFVoxel(w, h, *pixel);
-
-            // Fill neighbours array
-            voxel->neighboursNumber = 0;
-            for (int y = clampMin(h - 1, 0); y <= clampMax(h + 1, image.rows - 1); ++y) {
-                for (int x = clampMin(w - 1, 0); x <= clampMax(w + 1, image.cols - 1); ++x) {
-                    // Make sure it is not the same voxel
-                    if (y != h || x != w) {
-                        // Get neigbour only if the diff of the value is lower
-                        // than the tolerance - that will reduce number of
-                        // neighbours to be checked
-                        const uint16_t *neighbour = dataStart + x + y*image.cols;
-                        int distance = static_cast<int>(*neighbour) - static_cast<int>(*pixel);
-                        if (absBetween(distance, tolerance))
-                            voxel->neighbours[voxel->neighboursNumber++] = &getVoxel(x, y);
-                    }
-                }
-            }
-        }
+    uint16_t *depth = _depth.data();
+    for (int y = _y; y < _y + _height; ++y, depth += _width) {
+        const uint16_t *row = image.ptr<uint16_t>(y) + _x;
+        std::copy(row, row + _width, depth);
     }
 
     return true;
@@ -142,74 +94,126 @@ bool VoxelArray2D::fromImage(const cv::Mat &image, int tolerance)
 //////////////////////////////////////////////////
 
 void FloodFillClipped::init(int tolerance, const cv::Mat &source)
+{
+    init(tolerance, source, cv::Rect(0, 0, source.cols, source.rows));
+}
+
+void FloodFillClipped::init(int tolerance, const cv::Mat &source, const cv::Rect &region)
 {
     _tolerance = tolerance;
-    _voxelImage.fromImage(source, tolerance);
-    _usedMap.resize(source.rows*source.cols);
+    _voxelImage.fromImage(source, tolerance, region);
+
+    int width, height;
+    _voxelImage.getSize(width, height);
+    _usedMap.resize(static_cast<size_t>(width) * height);
+    _inFront.resize(static_cast<size_t>(width) * height);
+    _classifiedRows.resize(static_cast<size_t>(height));
 }
 
 bool FloodFillClipped::extractObject(Vec2i startingPoint, Plane plane, DepthObject &object)
 {
     object.reset();
 
-    int width, height;
-    _voxelImage.getSize(width, height);
+    if (!_voxelImage.contains(startingPoint.x, startingPoint.y))
+        return false;
 
-    std::fill(_usedMap.begin(), _usedMap.end(), false);
-    //std::vector<size_t> toFalse;
+    cv::Rect region = _voxelImage.getRegion();
+    int xEnd = region.x + region.width - 1;
+    int yEnd = region.y + region.height - 1;
+
+    // Get the mask of the voxels in front of the plane for the row, indexed
+    // like getRow. The whole row is classified at once when it is reached
+    // for the first time during this extraction.
+    auto getInFrontRow = [&](int y) {
+        uint8_t *inFront = _inFront.data() + _voxelImage.getIndex(region.x, y);
+        size_t rowIndex = static_cast<size_t>(y - region.y);
+        if (!_classifiedRows.isVisited(rowIndex)) {
+            plane.classify(region.x, y, _voxelImage.getRow(y) + region.x, region.width, inFront);
+            _classifiedRows.visit(rowIndex);
+        }
+        return inFront - region.x;
+    };
+
+    // Grow the run to the left and to the right from the voxel, which is
+    // already marked as used, and put it into the object
+    auto fillRun = [&](int x, int y) {
+        const uint16_t *row = _voxelImage.getRow(y);
+        const uint8_t *inFront = getInFrontRow(y);
+        Span span = { y, x, x };
+        while (span.x0 > region.x) {
+            int nx = span.x0 - 1;
+            size_t index = _voxelImage.getIndex(nx, y);
+            if (_usedMap.isVisited(index) || !inFront[nx] ||
+                !absBetween(static_cast<int>(row[nx]) - row[span.x0], _tolerance))
+                break;
+            _usedMap.visit(index);
+            span.x0 = nx;
+        }
+        while (span.x1 < xEnd) {
+            int nx = span.x1 + 1;
+            size_t index = _voxelImage.getIndex(nx, y);
+            if (_usedMap.isVisited(index) || !inFront[nx] ||
+                !absBetween(static_cast<int>(row[nx]) - row[span.x1], _tolerance))
+                break;
+            _usedMap.visit(index);
+            span.x1 = nx;
+        }
 
-    // Create queue for all voxels that must be analyzed
-    std::queue<FFVoxel *> enqueuedVoxels;
-    FFVoxel *firstVoxel = &_voxelImage.getVoxel(startingPoint.x, startingPoint.y);
+        object.putSpan(span.x0, y, row + span.x0, span.x1 - span.x0 + 1);
+        return span;
+    };
 
     // If the first voxel is behind the plane, skip extraction of the object
-    Vec3f voxelCoords = Vec3f(static_cast<float>(firstVoxel->coords.x),
-                                  static_cast<float>(firstVoxel->coords.y),
-                                  static_cast<float>(firstVoxel->coords.z));
-    if (plane(voxelCoords) < 0.0f)
+    uint8_t startInFront;
+    plane.classify(startingPoint.x, startingPoint.y,
+                   _voxelImage.getRow(startingPoint.y) + startingPoint.x, 1, &startInFront);
+    if (!startInFront)
         return false;
 
-    // Put first voxel to the queue
-    enqueuedVoxels.push(firstVoxel);
-
-    // Check all voxels until final solution is found
-    while (!enqueuedVoxels.empty()) {
-        // Dequeue the first voxel in the queue
-        FFVoxel *currentVoxel = enqueuedVoxels.front();
-        enqueuedVoxels.pop();
-
-        size_t voxelIndex = currentVoxel->coords.x + currentVoxel->coords.y*width;
-
-        // As the analyzis begun, the voxel can be set that it was analyzed
-        // and added as a part of the object
-        _usedMap[voxelIndex] = true;
-        //toFalse.push_back(voxelIndex);
-        object.putVoxel(currentVoxel);
-
-        // Analyze all neighbours. As we know that the VoxelArray was
-        // initialized using image and a tolerance, we can be sure that it will
-        // contain only those neighbours that are part of the object as a whole
-        for (int i = 0; i < currentVoxel->neighboursNumber; ++i) {
-            FFVoxel *neighbour = currentVoxel->neighbours[i];
-            size_t neighbourIndex = neighbour->coords.x + neighbour->coords.y*width;
-            Vec3f neighbourCoords(static_cast<float>(neighbour->coords.x),
-                                  static_cast<float>(neighbour->coords.y),
-                                  static_cast<float>(neighbour->coords.z));
-            // Push to queue only if the neigbour wasn't already analyzed and if
-            // the object is in front of or on the plane.
-            if (!_usedMap[neighbourIndex] && plane(neighbourCoords) >= 0.0f) {
-                _usedMap[neighbourIndex] = true;
-                //toFalse.push_back(neighbourIndex);
-                enqueuedVoxels.push(neighbour);
+    _usedMap.clear();
+    _classifiedRows.clear();
+    _spans.clear();
+
+    _usedMap.visit(_voxelImage.getIndex(startingPoint.x, startingPoint.y));
+    _spans.push_back(fillRun(startingPoint.x, startingPoint.y));
+
+    // Each run is checked for the neighbours in the row above and below it.
+    // The voxel is the neighbour if it is adjacent to any voxel of the run
+    // and the depth is in the tolerance, so the same voxels are extracted as
+    // when checking the neighbours of each voxel separately.
+    while (!_spans.empty()) {
+        Span span = _spans.back();
+        _spans.pop_back();
+
+        const uint16_t *row = _voxelImage.getRow(span.y);
+        for (int ny = span.y - 1; ny <= span.y + 1; ny += 2) {
+            if (ny < region.y || ny > yEnd)
+                continue;
+
+            const uint16_t *neighbourRow = _voxelImage.getRow(ny);
+            const uint8_t *inFront = getInFrontRow(ny);
+            int nxEnd = clampMax(span.x1 + 1, xEnd);
+            for (int nx = clampMin(span.x0 - 1, region.x); nx <= nxEnd; ++nx) {
+                size_t index = _voxelImage.getIndex(nx, ny);
+                if (_usedMap.isVisited(index) || !inFront[nx])
+                    continue;
+
+                bool connected = false;
+                int xLast = clampMax(nx + 1, span.x1);
+                for (int x = clampMin(nx - 1, span.x0); x <= xLast && !connected; ++x)
+                    connected = absBetween(static_cast<int>(neighbourRow[nx]) - row[x], _tolerance);
+                if (!connected)
+                    continue;
+
+                _usedMap.visit(index);
+                Span next = fillRun(nx, ny);
+                _spans.push_back(next);
+                // Voxels of the new run are already used
+                nx = next.x1;
             }
         }
     }
 
-    //for (auto it = toFalse.begin(); it != toFalse.end(); ++it)
-    {
-      //  _usedMap[*it] = false;
-    }
-
     return true;
 }
 
@@ -1,5 +1,7 @@
 #include <grl/gesture/GestureExtractor.h>
 
+#include <algorithm>
+
 namespace grl {
 
 //////////////////////////////////////////////////
@@ -11,64 +13,79 @@ DepthObject::DepthObject()
     reset();
 }
 
-void DepthObject::putVoxel(const Voxel *voxel)
+void DepthObject::putVoxel(const Voxel &voxel)
+{
+    uint16_t depth = static_cast<uint16_t>(voxel.coords.z);
+    putSpan(voxel.coords.x, voxel.coords.y, &depth, 1);
+}
+
+void DepthObject::putSpan(int x, int y, const uint16_t *depths, int count)
 {
-    _voxels.push_back(voxel);
+    if (count <= 0)
+        return;
+
+    // Continue the last run if the voxels are directly after it
+    bool continues = !_spanX.empty() && _spanY.back() == y &&
+        _spanX.back() + static_cast<int>(_depths.size() - _spanBegin.back()) == x;
+    if (!continues) {
+        _spanX.push_back(x);
+        _spanY.push_back(y);
+        _spanBegin.push_back(_depths.size());
+    }
+    _depths.insert(_depths.end(), depths, depths + count);
 
-    // The bounding box and depth ranges could be changed, so it must be
-    // checked.
-    // This can be reworked, so the maintainer of this object will make sure
-    // that the object is being recalcualted after all voxels are being added
-    // to the object.
-    recalculate3DBoundingBox(voxel);
+    // The bounds are extended once for the whole run
+    auto depthRange = std::minmax_element(depths, depths + count);
+    extendBounds(x, x + count - 1, y, *depthRange.first, *depthRange.second);
 
     _objectChanged = true;
 }
 
-void DepthObject::recalculate3DBoundingBox(const Voxel *voxel)
+void DepthObject::extendBounds(int xBegin, int xEnd, int y, int minDepth, int maxDepth)
 {
-    // Recalculate bounding box (width and height)
-    // Width
-    if (voxel->coords.x < _boundingBox.x) {
-        _boundingBox.x = voxel->coords.x;
-        _boundingBox.width = _maxX - _boundingBox.x + 1;
-    }
-    // No else, as when the first voxel is being put the coordinates are both
-    // smaller than bounding box (INT_MAX) and larger than max x (INT_MIN).
-    // If the object would be containing only from the single voxel, it's state
-    // and width would be invalid.
-    if (voxel->coords.x > _maxX) {
-        _maxX = voxel->coords.x;
-        // We must keep
-        _boundingBox.width = _maxX - _boundingBox.x + 1;
-    }
-
-    // Height
-    if (voxel->coords.y > _maxY) {
-        _maxY = voxel->coords.y;
-        _boundingBox.height = _maxY - _boundingBox.y + 1;
-    }
-    // Same comment for else as for the width.
-    if (voxel->coords.y < _boundingBox.y) {
-        _boundingBox.y = voxel->coords.y;
-        _boundingBox.height = _maxY - _boundingBox.y + 1;
-    }
+    // When the first run is being put the bounding box is at INT_MAX and the
+    // maximum coordinates at INT_MIN, so all of them are set.
+    _boundingBox.x = std::min(_boundingBox.x, xBegin);
+    _boundingBox.y = std::min(_boundingBox.y, y);
+    _maxX = std::max(_maxX, xEnd);
+    _maxY = std::max(_maxY, y);
+    _boundingBox.width = _maxX - _boundingBox.x + 1;
+    _boundingBox.height = _maxY - _boundingBox.y + 1;
 
-    // Recalculate min and max depth (ranges)
-    if (voxel->coords.z < _minDepth)
-        _minDepth = voxel->coords.z;
-    if (voxel->coords.z > _maxDepth)
-        _maxDepth = voxel->coords.z;
+    _minDepth = std::min(_minDepth, minDepth);
+    _maxDepth = std::max(_maxDepth, maxDepth);
 }
 
 size_t DepthObject::getSize() const
 {
-    return _voxels.size();
+    return _depths.size();
+}
+
+size_t DepthObject::getSpansNumber() const
+{
+    return _spanX.size();
+}
+
+DepthSpan DepthObject::getSpan(size_t i) const
+{
+    assert(i < _spanX.size());
+
+    size_t end = i + 1 < _spanBegin.size() ? _spanBegin[i + 1] : _depths.size();
+    DepthSpan span;
+    span.x = _spanX[i];
+    span.y = _spanY[i];
+    span.length = static_cast<int>(end - _spanBegin[i]);
+    span.depths = _depths.data() + _spanBegin[i];
+
+    return span;
 }
 
 void DepthObject::reset()
 {
-    _voxels.clear();
+    _spanX.clear();
+    _spanY.clear();
+    _spanBegin.clear();
+    _depths.clear();
     _depthImage = cv::Mat();
     _objectChanged = false;
     _minDepth = INT_MAX;
@@ -83,21 +100,52 @@ void
 DepthObject::generateImage() const
 {
     _depthImage = cv::Mat::zeros(_boundingBox.height, _boundingBox.width, CV_16UC1);
-    uint16_t *imgData = reinterpret_cast<uint16_t *>(_depthImage.data);
-
-    auto itVoxel = _voxels.begin();
-    for (; itVoxel != _voxels.end(); ++itVoxel) {
-        const Voxel *voxel = *itVoxel;
-        // The data can be accessed as an array, but the index must be calcualted
-        int pixelIndex = (voxel->coords.x - _boundingBox.x) +
-                         (voxel->coords.y - _boundingBox.y) * _boundingBox.width;
-        imgData[pixelIndex] = static_cast<uint16_t>(voxel->coords.z);
+
+    // Each run is a continuous part of the row of the image
+    for (size_t i = 0; i < getSpansNumber(); ++i) {
+        DepthSpan span = getSpan(i);
+        uint16_t *row = _depthImage.ptr<uint16_t>(span.y - _boundingBox.y) + (span.x - _boundingBox.x);
+        std::copy(span.depths, span.depths + span.length, row);
     }
 }
 
-const std::vector<const Voxel *> & DepthObject::getVoxels() const
+void DepthObject::getMask(cv::Mat &mask) const
 {
-    return _voxels;
+    mask = cv::Mat::zeros(_boundingBox.height, _boundingBox.width, CV_8UC1);
+
+    for (size_t i = 0; i < getSpansNumber(); ++i) {
+        DepthSpan span = getSpan(i);
+        uint8_t *row = mask.ptr<uint8_t>(span.y - _boundingBox.y) + (span.x - _boundingBox.x);
+        std::fill(row, row + span.length, static_cast<uint8_t>(UINT8_MAX));
+    }
+}
+
+void DepthObject::getDepthInMeters(cv::Mat &depth) const
+{
+    depth = cv::Mat::zeros(_boundingBox.height, _boundingBox.width, CV_32FC1);
+    putSpansInMeters(depth);
+}
+
+void DepthObject::getDepthInMeters(std::vector<float> &buffer, cv::Mat &depth) const
+{
+    size_t area = static_cast<size_t>(_boundingBox.width) * _boundingBox.height;
+    if (buffer.size() < area)
+        buffer.resize(area);
+    std::fill(buffer.begin(), buffer.begin() + area, 0.0f);
+
+    depth = cv::Mat(_boundingBox.height, _boundingBox.width, CV_32FC1, buffer.data());
+    putSpansInMeters(depth);
+}
+
+void DepthObject::putSpansInMeters(cv::Mat &depth) const
+{
+    for (size_t i = 0; i < getSpansNumber(); ++i) {
+        DepthSpan span = getSpan(i);
+        float *row = depth.ptr<float>(span.y - _boundingBox.y) + (span.x - _boundingBox.x);
+        // Convert milimeters to meters
+        for (int x = 0; x < span.length; ++x)
+            row[x] = static_cast<float>(span.depths[x]) / 1000.0f;
+    }
 }
 
 uint8_t DepthObject::getAccuracy() const
@@ -146,6 +194,12 @@ const cv::Mat & DepthObject::getDepthImageOfObject() const
 
 bool GestureExtractor::init(const ExtractorConfig &config)
 {
+    // One worker is enough, the second hand is extracted by the caller
+    if (config.parallelHands)
+        _handWorker = std::make_unique<ThreadPool>(1);
+    else
+        _handWorker.reset();
+
     return true;
 }
 
@@ -153,6 +207,23 @@ void GestureExtractor::extractHands(const cv::Mat &depthImage,
                                     const Skeleton &skeleton,
                                     DepthObject &leftHand,
                                     DepthObject &rightHand)
+{
+    // The image must be prepared only if any hand can be extracted
+    if (isHandValid(Side::Left, depthImage, skeleton) || isHandValid(Side::Right, depthImage, skeleton))
+        prepareFrame(depthImage);
+
+    extractPreparedHands(depthImage, skeleton, leftHand, rightHand);
+}
+
+void GestureExtractor::prepareFrame(const cv::Mat &depthImage)
+{
+}
+
+void GestureExtractor::extractPreparedHands(const cv::Mat &depthImage,
+                                            const Skeleton &skeleton,
+                                            DepthObject &leftHand,
+                                            DepthObject &rightHand,
+                                            bool useHandWorker)
 {
     // Reset both objects just in case.
     leftHand.reset();
@@ -164,6 +235,23 @@ void GestureExtractor::extractHands(const cv::Mat &depthImage,
     if (leftValid || rightValid)
         prepareExtraction(depthImage, skeleton);
 
+    if (rightValid && leftValid && useHandWorker && _handWorker) {
+        // After the preparation the hands are independent, so the left hand
+        // can be extracted at the same time as the right one
+        std::future<void> left = _handWorker->enqueue([&]() {
+            extractHand(Side::Left, depthImage, skeleton, leftHand);
+        });
+        try {
+            extractHand(Side::Right, depthImage, skeleton, rightHand);
+        } catch (...) {
+            // The task is using the references, it must finish first
+            left.wait();
+            throw;
+        }
+        left.get();
+        return;
+    }
+
     if (rightValid)
         extractHand(Side::Right, depthImage, skeleton, rightHand);
 
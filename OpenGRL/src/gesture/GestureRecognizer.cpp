@@ -3,6 +3,8 @@
 #include <grl/utils/ImageToolkit.h>
 #include <grl/utils/DebugTools.h>
 
+#include <algorithm>
+
 namespace grl {
 
 // The object that can be used for profiling if PROFILE is defined
@@ -59,21 +61,20 @@ GestureRecognizer::update(RecognitionMode mode)
 
     // Skeleton extraction
     if (mode & grlSkeleton) {
-        // Get skeletons
+        // Get skeletons and check if there is skeleton with valid lean
         Skeletons skeletons;
-        if (!_depthCamera->getSkeletons(&skeletons))
-            return ret;
-
-        if (skeletons.empty())
-            return ret;
-
-        // Check if there is skeleton with valid lean
         std::vector<Skeleton *> validSkeletons;
-        for (auto it = skeletons.begin(); it != skeletons.end(); ++it)
-            if (it->lean <= maxLeanAngle) validSkeletons.push_back(&(*it));
+        if (_depthCamera->getSkeletons(&skeletons)) {
+            for (auto it = skeletons.begin(); it != skeletons.end(); ++it)
+                if (it->lean <= maxLeanAngle) validSkeletons.push_back(&(*it));
+        }
 
-        if (validSkeletons.empty())
+        if (validSkeletons.empty()) {
+            // Nobody is tracked anymore, so the bodies are forgotten as well
+            if (_bodyWorkers)
+                _bodies.clear();
             return ret;
+        }
         ret |= GotSkeleton;
 
         Skeleton *closestSkeleton = *validSkeletons.begin();
@@ -81,6 +82,32 @@ GestureRecognizer::update(RecognitionMode mode)
             if (closestSkeleton->distance > (*it)->distance) closestSkeleton = *it;
 
         _skeleton = *closestSkeleton;
+
+        if (_bodyWorkers)
+            updateBodies(validSkeletons);
+    }
+
+    if (_bodyWorkers) {
+        // Hands of all bodies are extracted from the same prepared frame
+        if (mode & grlHandExtraction)
+            _extractor->prepareFrame(depthFrame);
+
+        std::vector<BodyState *> bodies;
+        for (auto it = _bodies.begin(); it != _bodies.end(); ++it)
+            bodies.push_back(&it->second);
+
+        TimeInterval t;
+        std::vector<uint64_t> statuses(bodies.size());
+        _bodyWorkers->parallelFor(bodies.size(), [&](size_t i) {
+            statuses[i] = updateBody(*bodies[i], mode, depthFrame);
+        });
+        t.finish();
+        profiler.addTime("bodies", t);
+
+        for (auto it = statuses.cbegin(); it != statuses.cend(); ++it)
+            ret |= *it;
+
+        return ret;
     }
 
     // Track update
@@ -134,6 +161,82 @@ GestureRecognizer::update(RecognitionMode mode)
 	return ret;
 }
 
+void
+GestureRecognizer::setMultiPerson(bool enabled, size_t nthreads)
+{
+    _bodies.clear();
+    if (enabled)
+        _bodyWorkers = std::make_unique<ThreadPool>(nthreads);
+    else
+        _bodyWorkers.reset();
+}
+
+void
+GestureRecognizer::updateBodies(const std::vector<Skeleton *> &skeletons)
+{
+    // Forget the bodies which are not tracked anymore
+    for (auto it = _bodies.begin(); it != _bodies.end();) {
+        uint64_t id = it->first;
+        bool tracked = std::any_of(skeletons.cbegin(), skeletons.cend(),
+                                   [id](const Skeleton *skeleton) { return skeleton->id == id; });
+        it = tracked ? std::next(it) : _bodies.erase(it);
+    }
+
+    for (auto it = skeletons.cbegin(); it != skeletons.cend(); ++it) {
+        BodyState &body = _bodies[(*it)->id];
+        if (!body.rightTracker) {
+            body.rightTracker = std::make_unique<GestureTracker>();
+            body.rightTracker->init(_rightTracker->getConfig());
+        }
+        body.skeleton = **it;
+    }
+}
+
+uint64_t
+GestureRecognizer::updateBody(BodyState &body, RecognitionMode mode, const cv::Mat &depthFrame)
+{
+    // Same steps as for the single person, the profiler is not used as it
+    // would be accessed from many threads
+    uint64_t ret = GotNothing;
+
+    // Track update
+    if (mode & grlTrack) {
+        body.lastTrackerState = body.rightTracker->update(body.skeleton.joints[RIGHT_HAND]);
+        if (body.lastTrackerState == GestureTracker::grlTrackerReset)
+            ret |= GotFinishedTrack;
+    }
+
+    // Track classification
+    if (mode & grlTrackClassification) {
+        if (body.lastTrackerState == GestureTracker::grlTrackerReset)
+            body.trackDesc = _trackClassificator->recognize(body.rightTracker->getLastTrack());
+    }
+
+    // Hand extraction, the bodies are already extracted in parallel, so both
+    // hands of the body are extracted by its worker
+    if (mode & grlHandExtraction) {
+        _extractor->extractPreparedHands(depthFrame, body.skeleton, body.leftHand, body.rightHand, false);
+        if (body.leftHand.getAccuracy() > 0 || body.rightHand.getAccuracy() > 0)
+            ret |= GotHands;
+    }
+
+    // Gesture extraction
+    if (mode & grlGesture) {
+        _handSkeletonExtractor->extractSkeleton(body.rightHand, body.rightHandSkeleton);
+        ret |= GotGesture;
+    }
+
+    // Gesture classification
+    if (mode & grlGestureClassification) {
+        body.gestureDesc = _gestureClassificator->recognize(body.rightHandSkeleton);
+        ret |= GotGestureClassification;
+    }
+
+    body.status = ret;
+
+    return ret;
+}
+
 void
 GestureRecognizer::getHandsImage(cv::Mat &destination)
 {
@@ -33,7 +33,32 @@ const std::array<const grl::GaussianKernel *, grl::grlHandIndexNum> RDFHandSkele
 bool RDFHandSkeletonExtractor::init(const std::string &fileWithRDF, const DepthCamera *camera)
 {
     _camera = camera;
-    return _forest.loadFromFile(fileWithRDF);
+    return setForest(fileWithRDF);
+}
+
+std::future<bool> RDFHandSkeletonExtractor::loadForestAsync(const std::string &fileWithRDF)
+{
+    // One thread is enough, it keeps the loads in the order of the requests
+    if (!_loader)
+        _loader = std::make_unique<ThreadPool>(1);
+
+    return _loader->enqueue([this, fileWithRDF]() {
+        return setForest(fileWithRDF);
+    });
+}
+
+bool RDFHandSkeletonExtractor::setForest(const std::string &fileWithRDF)
+{
+    // Parse into the new forest, nobody can see it until it is stored
+    auto forest = std::make_shared<RandomDecisionForest>();
+    if (!forest->loadFromFile(fileWithRDF)) {
+        std::cerr << "Failed to load the forest from " << fileWithRDF
+                  << ", keeping the current one" << std::endl;
+        return false;
+    }
+
+    std::atomic_store(&_forest, std::shared_ptr<const RandomDecisionForest>(std::move(forest)));
+    return true;
 }
 
 void RDFHandSkeletonExtractor::extractSkeleton(const grl::DepthObject &hand, grl::HandSkeleton &handSkeleton)
@@ -42,14 +67,64 @@ void RDFHandSkeletonExtractor::extractSkeleton(const grl::DepthObject &hand, grl
     grl::ClassesWeights weights;
     // 5 best points that had the best probability of being part of each class
     grl::ClassesPoints bestProbabilities;
+    // The depth camera is returning depth frame in uint16 representing
+    // millimeters, while the RDF is using floats representing meters.
+    ObjectPool<std::vector<float> >::Lease depthBuffer = _depthBuffers.acquire();
     cv::Mat depthForRDF;
-    convertDepthForRDF(hand, depthForRDF);
+    hand.getDepthInMeters(*depthBuffer, depthForRDF);
+
+    // Hold the forest for the whole frame, even if it is replaced meanwhile
+    std::shared_ptr<const RandomDecisionForest> forest = getForest();
+    cv::Mat classes;
+    if (forest) {
+        forest->classifyImage(depthForRDF, classes, weights, bestProbabilities);
+        approximateJoints(depthForRDF, weights, handSkeleton, bestProbabilities);
+    }
+
+    std::lock_guard<std::mutex> lock(_lastClassesMutex);
+    _lastClasses = classes;
+}
 
-    _forest.classifyImage(depthForRDF, _lastClasses, weights, bestProbabilities);
-    approximateJoints(depthForRDF, weights, handSkeleton, bestProbabilities);
+cv::Mat RDFHandSkeletonExtractor::getLastClasses() const
+{
+    std::lock_guard<std::mutex> lock(_lastClassesMutex);
+    return _lastClasses;
 }
 
 
+// Filter the row of the weights by the 1D kernel, starting at the kernel
+// coordinate kx and the image coordinate realX. The row is summed by four
+// independent sums, so the additions do not have to wait for each other.
+static void
+filterRow(const float *row, int count, const GaussianKernel &kernel, int kx, int realX,
+          float &sum, float &gradientX, float &certainty)
+{
+    float sums[4] = {};
+    float gradients[4] = {};
+    float certainties[4] = {};
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        for (int i = 0; i < 4; ++i) {
+            float wval = row[x + i];
+            float value = wval * kernel.getProfile(kx + x + i);
+            gradients[i] += value * (realX + x + i);
+            sums[i] += value;
+            certainties[i] += wval;
+        }
+    }
+    for (; x < count; ++x) {
+        float wval = row[x];
+        float value = wval * kernel.getProfile(kx + x);
+        gradients[0] += value * (realX + x);
+        sums[0] += value;
+        certainties[0] += wval;
+    }
+
+    sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    gradientX = (gradients[0] + gradients[1]) + (gradients[2] + gradients[3]);
+    certainty = (certainties[0] + certainties[1]) + (certainties[2] + certainties[3]);
+}
+
 std::pair<cv::Point2i, float> RDFHandSkeletonExtractor::densityEstimator(
     const cv::Mat &weights,
     const GaussianKernel &kernel,
@@ -78,6 +153,11 @@ std::pair<cv::Point2i, float> RDFHandSkeletonExtractor::densityEstimator(
     float sum = 0.0f;
     float gradientX = 0.0f;
     float gradientY = 0.0f;
+    // Sum of the probabilities, without the kernel
+    float certainty = 0.0f;
+    // The kernel is separable, so each row is filtered by the 1D kernel first
+    // and the row results are multiplied by the kernel value of the row, which
+    // gives the same sums as using kernel(kx, ky) for each pixel.
     // y - ROI coordinates
     // ky - kernel y coordinate (it can be different because of the borders)
     // realY - image y coordinate
@@ -85,20 +165,17 @@ std::pair<cv::Point2i, float> RDFHandSkeletonExtractor::densityEstimator(
          y < weightsROI.rows;
          ++ky, ++y, ++realY)
     {
-        // Definition of the variables same as for y
-        for (int x = 0, kx = skipLeft, realX = roi.x;
-             x < weightsROI.cols;
-             ++kx, ++x, ++realX)
-        {
-            float kval = kernel(kx, ky);
-            float wval = weightsROI.at<float>(cv::Point(x, y));
-            float value = wval * kval;
-            // Gradient is calculated using weight(roi_x,roi_y)*gauss(roi_x,roi_y)*x
-            // but because roi can be smaller then the kernel we must use separate counters.
-            gradientX += value * realX;
-            gradientY += value * realY;
-            sum += value;
-        }
+        // Gradient is calculated using weight(roi_x,roi_y)*gauss(roi_x,roi_y)*x
+        // but because roi can be smaller then the kernel we must use separate counters.
+        float rowSum, rowGradientX, rowCertainty;
+        filterRow(weightsROI.ptr<float>(y), weightsROI.cols, kernel, skipLeft, roi.x,
+                  rowSum, rowGradientX, rowCertainty);
+
+        float kval = kernel.getProfile(ky);
+        gradientX += kval * rowGradientX;
+        gradientY += kval * rowSum * realY;
+        sum += kval * rowSum;
+        certainty += rowCertainty;
     }
 
     // Check if there density is higher > 0
@@ -108,8 +185,8 @@ std::pair<cv::Point2i, float> RDFHandSkeletonExtractor::densityEstimator(
         result = std::make_pair(
             cv::Point(static_cast<int>(gradientX / sum),
                       static_cast<int>(gradientY / sum)),
-            static_cast<float>(cv::sum(weightsROI)[0]) // Take as a certainty sum of the probabilities
-                                // of pixels creating the mode.
+            certainty // Take as a certainty sum of the probabilities
+                      // of pixels creating the mode.
         );
     } else {
         // Otherwise, to prevent divide by 0, assign the 0 manually
@@ -139,15 +216,17 @@ void RDFHandSkeletonExtractor::approximateJoints(
         // Get the kernel for the given class (bigger parts have bigger kernel)
         const grl::GaussianKernel &kernel = *_kernels[i];
 
-        // We are taking few points that had the best probability with the given
-        // class to start looking for joints there.
+        // We are taking the point that had the best probability with the given
+        // class to start looking for the joint there. The points are sorted by
+        // the probability, so it is the last one.
         const std::multimap<float, Vec2i> &startingPoints = bestProbabilities[i];
 
         grl::HandJoint &joint = skeleton[jointIndex];
         std::pair<cv::Point2i, float> densityResult;
-        for (auto it = startingPoints.begin(); it != startingPoints.end(); ++it) {
+        if (!startingPoints.empty()) {
             // Start with this point
-            cv::Point centerPoint(it->second.x, it->second.y);
+            const Vec2i &startingPoint = startingPoints.rbegin()->second;
+            cv::Point centerPoint(startingPoint.x, startingPoint.y);
 
             // Adjust the location using density estimator until it won't change
             cv::Point oldPoint;
@@ -181,26 +260,4 @@ void RDFHandSkeletonExtractor::approximateJoints(
 }
 
 
-void RDFHandSkeletonExtractor::convertDepthForRDF(
-    const grl::DepthObject &hand,
-    cv::Mat &convertedDepth)
-{
-    const cv::Rect &handSize = hand.getBoundingBox();
-    // The depth camera is using as a unit milimeters in uint16_t, while the RDF is
-    // using as a unit meters in a float.
-    convertedDepth = cv::Mat::zeros(handSize.height, handSize.width, CV_32FC1);
-
-
-    for (auto itVoxel = hand.getVoxels().cbegin();
-         itVoxel != hand.getVoxels().cend();
-         ++itVoxel)
-    {
-        const Voxel *voxel = *itVoxel;
-        // Convert milimeters to meters
-        convertedDepth.at<float>(cv::Point(voxel->coords.x - handSize.x, voxel->coords.y - handSize.y)) =
-            static_cast<float>(voxel->coords.z)/1000.0f;
-    }
-}
-
-
 }
@@ -1,5 +1,8 @@
 #include <grl/gesture/SkeletonExtractor.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace grl {
 
 bool SkeletonExtractor::isHandValid(Side side, const cv::Mat &depthImage, const Skeleton &skeleton) const
@@ -14,9 +17,42 @@ bool SkeletonExtractor::isHandValid(Side side, const cv::Mat &depthImage, const
 }
 
 
+void SkeletonExtractor::prepareFrame(const cv::Mat &depthImage)
+{
+    // The components are shared by all hands of all skeletons
+    if (_config.connectedComponents)
+        _components.label(depthImage, _config.depthTolerance);
+}
+
 void SkeletonExtractor::prepareExtraction(const cv::Mat &depthImage, const Skeleton &skeleton)
 {
-    _ff.init(_config.depthTolerance, depthImage);
+    // The FloodFill is prepared separately for each hand, only in its region
+}
+
+cv::Rect SkeletonExtractor::getHandRegion(Side side, const cv::Mat &depthImage, const Skeleton &skeleton) const
+{
+    cv::Rect image(0, 0, depthImage.cols, depthImage.rows);
+    if (_config.maxHandSize <= 0.0f)
+        return image;
+
+    const Joint &wrist = skeleton.joints[side == Side::Right ? RIGHT_WRIST : LEFT_WRIST];
+    const Joint &elbow = skeleton.joints[side == Side::Right ? RIGHT_ELBOW : LEFT_ELBOW];
+
+    // Pixels per unit of the world coordinates at the depth of the forearm
+    float worldLength = (wrist.coordWorld - elbow.coordWorld).length();
+    if (worldLength < epsilon)
+        return image;
+    Vec2i imageVector(wrist.coordDepthImage.x - elbow.coordDepthImage.x,
+                      wrist.coordDepthImage.y - elbow.coordDepthImage.y);
+    float imageLength = imageVector.length();
+    int margin = static_cast<int>(std::ceil(_config.maxHandSize * imageLength / worldLength));
+
+    int minX = std::min(wrist.coordDepthImage.x, elbow.coordDepthImage.x) - margin;
+    int minY = std::min(wrist.coordDepthImage.y, elbow.coordDepthImage.y) - margin;
+    int maxX = std::max(wrist.coordDepthImage.x, elbow.coordDepthImage.x) + margin;
+    int maxY = std::max(wrist.coordDepthImage.y, elbow.coordDepthImage.y) + margin;
+
+    return cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1) & image;
 }
 
 void SkeletonExtractor::extractHand(Side side,
@@ -52,7 +88,18 @@ void SkeletonExtractor::extractHand(Side side,
 
     // Starting point should be in the middle between the elbow and the wrist
     // Try to extract the object from the image
-    if (_ff.extractObject(wrist2D, plane, hand))
+    // Only the part of the image that the hand can reach is used
+    cv::Rect region = getHandRegion(side, depthImage, skeleton);
+    bool extracted;
+    if (_config.connectedComponents) {
+        extracted = _components.extractObject(wrist2D, plane, region, hand);
+    } else {
+        ObjectPool<FloodFillClipped>::Lease ff = _floodFills.acquire();
+        ff->init(_config.depthTolerance, depthImage, region);
+        extracted = ff->extractObject(wrist2D, plane, hand);
+    }
+
+    if (extracted)
         // Set accuracy to 255 to indicate that the object was extracted, as we
         // do not have any algorithm to check accuraccy other way than binary.
         hand.setAccuracy(UINT8_MAX);
@@ -0,0 +1,221 @@
+#include <grl/rdf/CPUTrainingBackend.h>
+#include <grl/rdf/DecisionTree.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// The gather uses 64-bit pointers of the images
+#if defined(_M_X64) || defined(__x86_64__)
+#define GRL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows the intrinsics in any function
+#define GRL_TARGET_AVX2
+#else
+#define GRL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace grl {
+
+#ifdef GRL_X86
+namespace {
+
+constexpr int blockSize = 8;
+
+// Round half away from zero, the same as std::round. _mm256_round_ps only
+// rounds half to even, so the value is truncated and corrected by one if
+// the truncated part was at least 0.5.
+GRL_TARGET_AVX2 inline __m256
+roundHalfAway(__m256 val)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 truncated = _mm256_round_ps(val, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256 fraction = _mm256_andnot_ps(signMask, _mm256_sub_ps(val, truncated));
+    __m256 roundUp = _mm256_cmp_ps(fraction, _mm256_set1_ps(0.5f), _CMP_GE_OQ);
+    __m256 one = _mm256_or_ps(_mm256_and_ps(val, signMask), _mm256_set1_ps(1.0f));
+
+    return _mm256_add_ps(truncated, _mm256_and_ps(roundUp, one));
+}
+
+// Read the depth at the index in lanes with set mask. The images of the
+// lanes can be different, so the absolute addresses are gathered.
+GRL_TARGET_AVX2 inline __m256
+gatherDepth(__m256i index, __m256i mask, const float * const *images)
+{
+    __m256i addrlo = _mm256_add_epi64(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(images)),
+        _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(index)), 2));
+    __m256i addrhi = _mm256_add_epi64(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(images + 4)),
+        _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(index, 1)), 2));
+
+    __m256 fmask = _mm256_castsi256_ps(mask);
+    __m128 depthlo = _mm256_mask_i64gather_ps(_mm_setzero_ps(), static_cast<const float *>(nullptr),
+                                              addrlo, _mm256_castps256_ps128(fmask), 1);
+    __m128 depthhi = _mm256_mask_i64gather_ps(_mm_setzero_ps(), static_cast<const float *>(nullptr),
+                                              addrhi, _mm256_extractf128_ps(fmask, 1), 1);
+
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(depthlo), depthhi, 1);
+}
+
+struct BlockGeometry
+{
+    __m256i maxX;
+    __m256i maxY;
+    __m256i stride;
+};
+
+// Get the mask of the lanes, in which the offset points to the foreground
+// pixel inside of the image and the depth of that pixel.
+GRL_TARGET_AVX2 inline __m256i
+getOffsetDepth(float offsetX, float offsetY, __m256 invDepth, __m256i x, __m256i y,
+               const BlockGeometry &geometry, const float * const *images, __m256 &offsetDepth)
+{
+    __m256i tx = _mm256_add_epi32(x, _mm256_cvttps_epi32(
+        roundHalfAway(_mm256_mul_ps(_mm256_set1_ps(offsetX), invDepth))));
+    __m256i ty = _mm256_add_epi32(y, _mm256_cvttps_epi32(
+        roundHalfAway(_mm256_mul_ps(_mm256_set1_ps(offsetY), invDepth))));
+
+    // Inside of the image: 0 <= t <= max
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i outside = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpgt_epi32(zero, tx), _mm256_cmpgt_epi32(tx, geometry.maxX)),
+        _mm256_or_si256(_mm256_cmpgt_epi32(zero, ty), _mm256_cmpgt_epi32(ty, geometry.maxY)));
+    __m256i inside = _mm256_xor_si256(outside, _mm256_set1_epi32(-1));
+
+    __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(ty, geometry.stride), tx);
+    offsetDepth = gatherDepth(index, inside, images);
+
+    // Not background: !(d > grlDepthMaxDist) && !(d < epsilon)
+    __m256 foreground = _mm256_and_ps(
+        _mm256_cmp_ps(offsetDepth, _mm256_set1_ps(grlDepthMaxDist), _CMP_NGT_UQ),
+        _mm256_cmp_ps(offsetDepth, _mm256_set1_ps(epsilon), _CMP_NLT_UQ));
+
+    return _mm256_and_si256(inside, _mm256_castps_si256(foreground));
+}
+
+// Evaluate the decision for the pixels in range [first, last), which must
+// be a multiple of the block size.
+GRL_TARGET_AVX2 void
+evaluateBlocks(const Decision &decision, const TrainingPixels &pixels, size_t first, size_t last,
+               uint8_t *directions, ClassCounts &leftCounts)
+{
+    BlockGeometry geometry;
+    geometry.maxX = _mm256_set1_epi32(pixels.getCols() - 1);
+    geometry.maxY = _mm256_set1_epi32(pixels.getRows() - 1);
+    geometry.stride = _mm256_set1_epi32(static_cast<int>(pixels.getStride()));
+    const __m256 threshold = _mm256_set1_ps(decision.t);
+
+    const int16_t *xs = pixels.getX();
+    const int16_t *ys = pixels.getY();
+    const float *invDepths = pixels.getInvDepth();
+    const float * const *images = pixels.getImages();
+    const int8_t *classes = pixels.getClasses();
+
+    for (size_t i = first; i < last; i += blockSize) {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(xs + i)));
+        __m256i y = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ys + i)));
+        __m256 invDepth = _mm256_loadu_ps(invDepths + i);
+
+        __m256 udepth, vdepth;
+        __m256i uvalid = getOffsetDepth(static_cast<float>(decision.u.x), static_cast<float>(decision.u.y),
+                                        invDepth, x, y, geometry, images + i, udepth);
+        __m256i vvalid = getOffsetDepth(static_cast<float>(decision.v.x), static_cast<float>(decision.v.y),
+                                        invDepth, x, y, geometry, images + i, vdepth);
+
+        __m256 less = _mm256_cmp_ps(_mm256_sub_ps(udepth, vdepth), threshold, _CMP_LT_OQ);
+        __m256i left = _mm256_and_si256(_mm256_and_si256(uvalid, vvalid), _mm256_castps_si256(less));
+        int leftMask = _mm256_movemask_ps(_mm256_castsi256_ps(left));
+
+        for (int lane = 0; lane < blockSize; ++lane) {
+            if (leftMask & (1 << lane)) {
+                directions[i + lane] = grlNodeGoLeft;
+                ++leftCounts[classes[i + lane]];
+            } else {
+                directions[i + lane] = grlNodeGoRight;
+            }
+        }
+    }
+}
+
+}
+#endif // GRL_X86
+
+bool
+AVX2TrainingBackend::isSupported()
+{
+#if defined(GRL_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // AVX and OSXSAVE, then check if the OS saves the YMM registers
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(GRL_X86)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+bool
+AVX2TrainingBackend::evaluateDecision(const Decision &decision,
+                                      const TrainingPixels &pixels,
+                                      std::vector<uint8_t> &directions,
+                                      ClassCounts &leftCounts)
+{
+#ifdef GRL_X86
+    directions.resize(pixels.size());
+    leftCounts.fill(0);
+
+    size_t blocks = pixels.size() / blockSize;
+    size_t tail = blocks * blockSize;
+
+#ifdef _OPENMP
+    if (pixels.size() > pixelSizeSP) {
+        // Split the blocks evenly between the threads
+#pragma omp parallel shared(leftCounts)
+        {
+            ClassCounts tcounts = {};
+            size_t nthreads = omp_get_num_threads();
+            size_t thread = omp_get_thread_num();
+            size_t first = blocks * thread / nthreads * blockSize;
+            size_t last = blocks * (thread + 1) / nthreads * blockSize;
+            evaluateBlocks(decision, pixels, first, last, directions.data(), tcounts);
+
+            for (int i = 0; i < grlHandIndexNum; ++i) {
+#pragma omp atomic
+                leftCounts[i] += tcounts[i];
+            }
+        }
+    } else
+#endif // _OPENMP
+        evaluateBlocks(decision, pixels, 0, tail, directions.data(), leftCounts);
+
+    // Pixels not filling the whole block
+    const int8_t *classes = pixels.getClasses();
+    for (size_t i = tail; i < pixels.size(); ++i) {
+        directions[i] = grl::evaluateDecision(decision, pixels, i);
+        if (directions[i] == grlNodeGoLeft)
+            ++leftCounts[classes[i]];
+    }
+
+    return true;
+#else
+    return setError("AVX2 backend is supported only on x86-64");
+#endif
+}
+
+}
@@ -0,0 +1,88 @@
+#include <grl/rdf/CPUTrainingBackend.h>
+#include <grl/rdf/DecisionTree.h>
+
+namespace grl {
+
+bool
+CPUTrainingBackend::setNodePixels(const TrainingPixels &pixels,
+                                  const std::vector<cv::Mat> &depthImages)
+{
+    // Nothing to prepare, the images are read through the pointers of the pixels
+    return true;
+}
+
+bool
+CPUTrainingBackend::getClassCounts(const TrainingPixels &pixels, ClassCounts &counts)
+{
+    const int8_t *classes = pixels.getClasses();
+    counts.fill(0);
+
+#ifdef _OPENMP
+    if (pixels.size() > pixelSizeSP) {
+        // Get the histogram
+#pragma omp parallel shared(counts)
+        {
+            ClassCounts tcounts = {};
+#pragma omp for
+            for (int i = 0; i < static_cast<int>(pixels.size()); ++i)
+                ++tcounts[classes[i]];
+
+            for (int i = 0; i < grlHandIndexNum; ++i) {
+#pragma omp atomic
+                counts[i] += tcounts[i];
+            }
+        }
+    } else
+#endif // _OPENMP
+        for (size_t i = 0; i < pixels.size(); ++i)
+            ++counts[classes[i]];
+
+    return true;
+}
+
+bool
+CPUTrainingBackend::evaluateDecision(const Decision &decision,
+                                     const TrainingPixels &pixels,
+                                     std::vector<uint8_t> &directions,
+                                     ClassCounts &leftCounts)
+{
+    const int8_t *classes = pixels.getClasses();
+    directions.resize(pixels.size());
+    leftCounts.fill(0);
+
+#ifdef _OPENMP
+    // Determine if OpenMP should be used. If the number of pixels is not big,
+    // it may be faster do skip the SMP part because of the cost of creating
+    // the threads.
+    if (pixels.size() > pixelSizeSP) {
+#pragma omp parallel shared(leftCounts)
+        {
+            ClassCounts tcounts = {};
+#pragma omp for
+            for (int i = 0; i < static_cast<int>(pixels.size()); ++i) {
+                uint8_t direction = grl::evaluateDecision(decision, pixels, i);
+                directions[i] = direction;
+                if (direction == grlNodeGoLeft)
+                    ++tcounts[classes[i]];
+            }
+
+            for (int i = 0; i < grlHandIndexNum; ++i) {
+#pragma omp atomic
+                leftCounts[i] += tcounts[i];
+            }
+        }
+    } else
+#endif // _OPENMP
+        // Do that in single process if the OpenMP is not being used or the
+        // number of pixels is not big
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            uint8_t direction = grl::evaluateDecision(decision, pixels, i);
+            directions[i] = direction;
+            if (direction == grlNodeGoLeft)
+                ++leftCounts[classes[i]];
+        }
+
+    return true;
+}
+
+}
@@ -1,13 +1,18 @@
 #include <grl/rdf/DecisionTree.h>
 
+#include <algorithm>
 #include <cassert>
-#include <ctime>
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+#include <chrono>
+#include <utility>
 
 namespace grl {
 
+static double
+getSecondsSince(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
 void
 Node::setLeaf(bool leaf)
 {
@@ -30,43 +35,8 @@ uint8_t
 Node::evaluateFeature(const cv::Mat &depthImage, const Pixel &p) const
 {
     assert(!_isLeaf);
-    bool backgroundHit;
-
-    // Offset u
-    Vec2i tu = Vec2i{
-        p.coords.x + static_cast<int>(std::round(_decision.u.x/p.depth)),
-        p.coords.y + static_cast<int>(std::round(_decision.u.y/p.depth))
-    };
-    // Check if on border
-    backgroundHit = !isBetween(tu.x, depthImage.cols-1, 0) ||
-                    !isBetween(tu.y, depthImage.rows-1, 0);
-    if (backgroundHit)
-        return grlNodeGoRight;
-
-    // Check is depth is background
-    float udepth = depthImage.at<float>(tu.y, tu.x);
-    backgroundHit = udepth > grlDepthMaxDist || udepth < epsilon;
-    if (backgroundHit)
-        return grlNodeGoRight;
-
-    // Offset v
-    Vec2i tv = Vec2i{
-        p.coords.x + static_cast<int>(std::round(_decision.v.x/p.depth)),
-        p.coords.y + static_cast<int>(std::round(_decision.v.y/p.depth))
-    };
-    // Check if on border
-    backgroundHit = !isBetween(tv.x, depthImage.cols-1, 0) ||
-                    !isBetween(tv.y, depthImage.rows-1, 0);
-    if (backgroundHit)
-        return grlNodeGoRight;
-
-    // Check is depth is background
-    float vdepth = depthImage.at<float>(tv.y, tv.x);
-    backgroundHit = vdepth > grlDepthMaxDist || vdepth < epsilon;
-    if (backgroundHit)
-        return grlNodeGoRight;
-
-    return ((udepth - vdepth) < _decision.t) ? grlNodeGoLeft : grlNodeGoRight;
+
+    return evaluateDecision(_decision, depthImage, p);
 }
 
 void
@@ -102,7 +72,7 @@ Node::saveToFile(std::ofstream &file)
 }
 
 const Node *
-Node::getLeafForPixel(const cv::Mat &depthImage, const Pixel &p)
+Node::getLeafForPixel(const cv::Mat &depthImage, const Pixel &p) const
 {
     const Node *node = this;
 
@@ -115,134 +85,93 @@ Node::getLeafForPixel(const cv::Mat &depthImage, const Pixel &p)
     return node;
 }
 
-void
-DecisionTree::getProbabilities(const std::vector<Pixel> *pixels, std::vector<float> &probabilities)
+double
+DecisionTree::getSplitScore(const NodeTrainingData &data)
 {
-    probabilities.clear();
-    probabilities.resize(grlHandIndexNum);
-    std::fill(probabilities.begin(), probabilities.end(), 0.0f);
-
-#ifdef _OPENMP
-    if (pixels->size() > pixelSizeSP) {
-        // Get the histogram
-#pragma omp parallel shared(probabilities)
-        {
-            std::vector<float> tprobabilities(grlHandIndexNum);
-            std::fill(tprobabilities.begin(), tprobabilities.end(), 0.0f);
-#pragma omp for
-            for (size_t i = 0; i < pixels->size(); ++i) {
-                ++tprobabilities[(*pixels)[i].classIndex];
-            }
+    uint32_t leftSize = getCountsSum(data.leftCounts);
+    if (leftSize == 0 || leftSize == data.allPixels->size()) {
+        // This means, that this node should be treated as a leaf the nodes
+        // cannot be further divided.
+        return -std::numeric_limits<double>::infinity();
+    }
 
-            for (int i = 0; i < grlHandIndexNum; ++i) {
-#pragma omp atomic
-                probabilities[i] += tprobabilities[i];
-            }
-        }
-    } else
-#endif _OPENMP
-	    for (auto it = pixels->cbegin(); it != pixels->cend(); ++it)
-		    ++probabilities[it->classIndex];
-
-    // Normalize the probabilities
-    size_t sum = pixels->size();
-    for (auto it = probabilities.begin(); it != probabilities.end(); ++it)
-        (*it) /= sum;
+    return EntropyTable::getInstance().getGain(data.allCounts, data.leftCounts);
 }
 
-
-float
-DecisionTree::evaluateNode(Node *node, NodeTrainingData &data, const std::vector<cv::Mat> &depthImages)
+void
+DecisionTree::releasePixels(Node *node, TreeMemoryTracker &memory)
 {
-    data.leftPixels->clear();
-    data.leftProbabilities.clear();
-    data.rightPixels->clear();
-    data.rightProbabilities.clear();
-
-#ifdef _OPENMP
-    // Determine if OpenMP should be used. If the number of pixels is not big,
-    // it may be faster do skip the SMP part because of the cost of creating
-    // the threads.
-    if (data.allPixels->size() > pixelSizeSP) {
-        std::vector<uint8_t> directions(data.allPixels->size());
-
-#pragma omp parallel for
-        for (size_t i = 0; i < data.allPixels->size(); ++i) {
-            const Pixel &p = (*data.allPixels)[i];
-            const cv::Mat &depthImage = depthImages[p.imgID];
-            directions[i] = node->evaluateFeature(depthImage, p);
-        }
+    if (node == nullptr || node->getPixels() == nullptr)
+        return;
 
-        // Distribute the pixels for right and left node
-        auto itPix = data.allPixels->cbegin();
-        for (auto it = directions.begin(); it != directions.end(); ++it, ++itPix) {
-            if (*it == grlNodeGoLeft)
-                data.leftPixels->push_back(*itPix);
-            else
-                data.rightPixels->push_back(*itPix);
-        }
-    } else
-#endif // _OPENMP
-        // Do that in single process if the OpenMP is not being used or the
-        // number of pixels is not big
-        for (size_t i = 0; i < data.allPixels->size(); ++i) {
-            const Pixel &p = (*data.allPixels)[i];
-            const cv::Mat &depthImage = depthImages[p.imgID];
-            // Distribute the pixels for right and left node
-            if (node->evaluateFeature(depthImage, p) == grlNodeGoLeft)
-                data.leftPixels->push_back(p);
-            else
-                data.rightPixels->push_back(p);
-        }
+    memory.release(node->getPixels()->getMemorySize());
+    delete node->getPixels();
+    node->setPixels(nullptr);
+}
 
-    if (data.leftPixels->empty() || data.rightPixels->empty()) {
-        // This means, that this node should be treated as a leaf the nodes
-        // cannot be further divided.
-        return -std::numeric_limits<float>::infinity();
-    }
+void
+DecisionTree::abortTraining(TreeMemoryTracker &memory)
+{
+    std::vector<Node *> nodes;
+    if (_root.get() != nullptr)
+        nodes.push_back(_root.get());
 
-    // Get the probabilities of each distributions
-    getProbabilities(data.leftPixels, data.leftProbabilities);
-    getProbabilities(data.rightPixels, data.rightProbabilities);
+    while (!nodes.empty()) {
+        Node *node = nodes.back();
+        nodes.pop_back();
 
-    // Calculate the entropy for the distribution
-    float allShanon = getShannonEntropy(data.allProbabilities);
-    float leftEntropy = static_cast<float>(data.leftPixels->size())/data.allPixels->size() *
-        getShannonEntropy(data.leftProbabilities);
-    float rightEntropy = static_cast<float>(data.rightPixels->size())/data.allPixels->size() *
-        getShannonEntropy(data.rightProbabilities);
+        releasePixels(node, memory);
+        if (node->getLeft() != nullptr)
+            nodes.push_back(node->getLeft());
+        if (node->getRight() != nullptr)
+            nodes.push_back(node->getRight());
+    }
 
-    // And return the score
-    return allShanon - leftEntropy - rightEntropy;
+    _root.reset();
 }
 
-void
-DecisionTree::train(std::vector<Pixel> *pixels, const std::vector<cv::Mat> &depthImages,
-                    int nodeTrainLimit, int maxDepth, std::mt19937 &gen, TreeTrainGPUContext *gpuContext)
+Decision
+DecisionTree::getCandidate(const RandomStream &stream, uint64_t nodeID, int candidate)
 {
-    // Offsets u and v
-    std::uniform_int_distribution<> offsetDistribution(-learnOffsetDistr, learnOffsetDistr);
-    // Threshold parameter (determines if the pixels should go left or right)
-    std::uniform_real_distribution<float> thresholdDistribution(-learnThresholdDistr, learnThresholdDistr);
+    RandomStream candidateStream = stream.getSubstream(nodeID).getSubstream(candidate);
+
+    // Offsets u and v and the threshold parameter (determines if the pixels
+    // should go left or right)
+    Decision decision;
+    decision.u.x = candidateStream.uniformInt(-learnOffsetDistr, learnOffsetDistr);
+    decision.u.y = candidateStream.uniformInt(-learnOffsetDistr, learnOffsetDistr);
+    decision.v.x = candidateStream.uniformInt(-learnOffsetDistr, learnOffsetDistr);
+    decision.v.y = candidateStream.uniformInt(-learnOffsetDistr, learnOffsetDistr);
+    decision.t = candidateStream.uniformReal(-learnThresholdDistr, learnThresholdDistr);
+
+    return decision;
+}
 
+bool
+DecisionTree::train(TrainingPixels *pixels, const std::vector<cv::Mat> &depthImages,
+                    int nodeTrainLimit, int maxDepth, const RandomStream &stream, TrainingBackend &backend,
+                    TreeMemoryTracker &memory, std::vector<NodeMetrics> &nodeMetrics)
+{
     NodeTrainingData data;
     data.allPixels = pixels;
+    memory.allocate(pixels->getMemorySize());
+
+    if (!backend.getClassCounts(*data.allPixels, data.allCounts)) {
+        memory.release(pixels->getMemorySize());
+        delete pixels;
+        return false;
+    }
 
-#ifdef USE_GPU
-    bool useGPU = gpuContext != nullptr;
-    if (useGPU)
-        getProbabilities(data.allPixels, data.allProbabilities, gpuContext);
-    else
-#endif
-        getProbabilities(data.allPixels, data.allProbabilities);
+    std::vector<float> probabilities;
+    getProbabilities(data.allCounts, probabilities);
 
     if (_root.get() != nullptr)
         _root.release();
-    _root = std::make_unique<Node>(data.allPixels, data.allProbabilities);
+    _root = std::make_unique<Node>(data.allPixels, probabilities);
     Node *node = _root.get();
-    // Values for debug, depth and trained nodes
+    uint64_t nodeID = 1;
     int depth = 1;
-    int good = 0;
+    nodeMetrics.clear();
     while (node != nullptr) {
         // Determine if we should stay at this node, go up or go right
         if (node->getPixels() == nullptr) {
@@ -251,154 +180,180 @@ DecisionTree::train(std::vector<Pixel> *pixels, const std::vector<cv::Mat> &dept
             // If so, it means we must go deeper.
             if (!node->isLeaf() && node->getRight()->getPixels() != nullptr) {
                 node = node->getRight();
+                nodeID = 2 * nodeID + 1;
                 ++depth;
             } else {
                 node = node->getParent();
+                nodeID /= 2;
                 --depth;
             }
             continue;
         }
 
-        ++good;
+        auto beginTime = std::chrono::steady_clock::now();
+        NodeMetrics metrics = {};
+        metrics.nodeID = nodeID;
+        metrics.depth = depth;
+        metrics.gain = std::numeric_limits<double>::quiet_NaN();
 
         // Get all pixels which should be split further
         data.allPixels = node->getPixels();
-        data.allProbabilities = node->getProbabilities();
+        metrics.pixels = data.allPixels->size();
+        if (node != _root.get() && !backend.getClassCounts(*data.allPixels, data.allCounts)) {
+            abortTraining(memory);
+            return false;
+        }
 
-        printf("Training node %d at depth %d with %ju\n", good, depth, data.allPixels->size());
-        // Flush for SMP
-        fflush(stdout);
         // Set the node as leaf if max depth is achieved or the all pixels are from
         // only one class
-        if (depth == maxDepth || isSingleClass(data.allProbabilities)) {
-            std::cout << "Depth limit or single class at " << depth << ".\n";
+        if (depth == maxDepth || isSingleClass(data.allCounts)) {
             // Do not set probabilities as they should be already set
             node->setLeaf(true);
+            memory.release(data.allPixels->getMemorySize());
             delete data.allPixels;
             node->setPixels(nullptr);
             node = node->getParent();
+            nodeID /= 2;
             --depth;
+            metrics.seconds = getSecondsSince(beginTime);
+            nodeMetrics.push_back(metrics);
             continue;
         }
 
-        data.leftPixels = new std::vector<Pixel>;
-        data.rightPixels = new std::vector<Pixel>;
-        data.leftPixels->reserve(data.allPixels->size());
-        data.rightPixels->reserve(data.allPixels->size());
-
+        // Only the directions of the pixels are kept for the candidates, the
+        // pixels are distributed to the children for the best one only
         Decision bestDecision;
-        std::vector<Pixel> *bestLeftPixels = nullptr;
-        std::vector<Pixel> *bestRightPixels = nullptr;
-        std::vector<float> bestLeftProbabilities, bestRightProbabilities;
-        float bestScore = -std::numeric_limits<float>::infinity();
-#ifdef _OPENMP
-        const float begin_time = omp_get_wtime();
-#else
-        const clock_t begin_time = clock();
-#endif
-#ifdef USE_GPU
-        // If the GPU is used, the image data must be prepared
-        if (useGPU) {
-            err = gpuContext->queue.enqueueWriteBuffer(gpuContext->bufferAllPix, CL_TRUE, 0,
-                                                       sizeof(Pixel)*data.allPixels->size(), data.allPixels->data());
-            if (err != CL_SUCCESS) {
-                std::cout << "All pix write error: \n" << err << std::endl;
-                exit(-1);
-            }
-            err = gpuContext->getFeatureTrain.setArg(1, gpuContext->bufferAllPix);
-            if (err != CL_SUCCESS) {
-                std::cout << "Set all pix error: \n" << err << std::endl;
-                exit(-1);
-            }
-            // Get all images ids which should be analyzed
-            data.imageIDs.clear();
-            data.imagesPixelCount.clear();
-            data.imagesPixelCount.push_back(0);
-            data.imageIDs.push_back(data.allPixels->front().imgID);
-            for (auto it = data.allPixels->cbegin(); it != data.allPixels->cend(); ++it) {
-                if (data.imageIDs.back() != it->imgID) {
-                    data.imageIDs.push_back(it->imgID);
-                    data.imagesPixelCount.push_back(1);
-                } else {
-                    ++data.imagesPixelCount.back();
-                }
-            }
+        std::vector<uint8_t> bestDirections(data.allPixels->size());
+        // Directions of the best and the evaluated candidate
+        size_t directionsMemory = 2 * data.allPixels->size() * sizeof(uint8_t);
+        memory.allocate(directionsMemory);
+        ClassCounts bestLeftCounts = {};
+        double bestScore = -std::numeric_limits<double>::infinity();
+        if (!backend.setNodePixels(*data.allPixels, depthImages)) {
+            memory.release(directionsMemory);
+            abortTraining(memory);
+            return false;
         }
-#endif
+
         // Try to train the node, each time randomly choosing another feature.
+        // If more candidates have the same score, the first one is kept.
         for (int i = 0; i < nodeTrainLimit; ++i) {
-            Decision decision = {
-                {offsetDistribution(gen), offsetDistribution(gen)}, // u
-            {offsetDistribution(gen), offsetDistribution(gen)}, // v
-            thresholdDistribution(gen)}; // t
-            node->setDecision(decision);
-            float score;
-#ifdef USE_GPU
-            if (useGPU) {
-                err = gpuContext->getFeatureTrain.setArg(2, sizeof(Decision), &decision);
-                if (err != CL_SUCCESS) {
-                    std::cout << "Set decision error: \n" << err << std::endl;
-                    exit(-1);
-                }
-                score = evaluateNode(node, data, depthImages, gpuContext);
-            } else {
-#endif
-                score = evaluateNode(node, data, depthImages);
-#ifdef USE_GPU
+            Decision decision = getCandidate(stream, nodeID, i);
+            if (!backend.evaluateDecision(decision, *data.allPixels,
+                                          data.directions, data.leftCounts)) {
+                memory.release(directionsMemory);
+                abortTraining(memory);
+                return false;
             }
-#endif
+            double score = getSplitScore(data);
             // Save the feature with the best score.
             if (score > bestScore) {
                 bestScore = score;
                 bestDecision = decision;
-                delete bestLeftPixels;
-                delete bestRightPixels;
-                // It is used to save a bit of RAM
-                data.leftPixels->shrink_to_fit();
-                data.rightPixels->shrink_to_fit();
-                bestLeftPixels = data.leftPixels;
-                bestRightPixels = data.rightPixels;
-                data.leftPixels = new std::vector<Pixel>;
-                data.rightPixels = new std::vector<Pixel>;
-                bestLeftProbabilities = data.leftProbabilities;
-                bestRightProbabilities = data.rightProbabilities;
+                bestDirections.swap(data.directions);
+                bestLeftCounts = data.leftCounts;
             }
         }
-#ifdef _OPENMP
-        std::cout << float(omp_get_wtime() - begin_time) << " With score: " << bestScore << std::endl;
-#else
-        std::cout << float(clock() - begin_time) /  CLOCKS_PER_SEC << std::endl;
-#endif
-
-        // if didn't managed to get any score, go up and make the parent the leaf
-        if (bestScore == -std::numeric_limits<float>::infinity() ||
-            bestLeftPixels->empty() || bestRightPixels->empty()) {
-            std::cout << "No best score at depth " << depth << ". Go up.\n";
+        metrics.candidates = nodeTrainLimit;
+
+        // if didn't managed to get any score, go up and make the parent the leaf.
+        // The root has no parent, so it becomes the leaf itself.
+        if (bestScore == -std::numeric_limits<double>::infinity()) {
+            Node *leaf = node->getParent() != nullptr ? node->getParent() : node;
+            // The pixels of both children are freed with the leaf
+            releasePixels(leaf, memory);
+            releasePixels(leaf->getLeft(), memory);
+            releasePixels(leaf->getRight(), memory);
+            leaf->setLeaf(true);
+
             node = node->getParent();
+            nodeID /= 2;
             --depth;
-            if (node != nullptr) {
-                node->setLeaf(true);
-            }
         } else {
-            std::cout << "Best score " << bestScore << " at depth " << depth
-                << ". Left: " << bestLeftPixels->size() << ", Right: " << bestRightPixels->size()
-                << " .\n";
-            std::cout << "Best decision: t = " << bestDecision.t
-                << " u = (" << bestDecision.u.x << ", " << bestDecision.u.y
-                << ") v = (" << bestDecision.v.x << ", " << bestDecision.v.y << ")\n";
+            ClassCounts bestRightCounts;
+            for (size_t i = 0; i < bestRightCounts.size(); ++i)
+                bestRightCounts[i] = data.allCounts[i] - bestLeftCounts[i];
+
+            // Distribute the pixels to left and right node.
+            TrainingPixels *bestLeftPixels = new TrainingPixels;
+            TrainingPixels *bestRightPixels = new TrainingPixels;
+            data.allPixels->partition(bestDirections, grlNodeGoLeft, *bestLeftPixels, *bestRightPixels);
+            memory.allocate(bestLeftPixels->getMemorySize() + bestRightPixels->getMemorySize());
+            metrics.gain = bestScore;
+
             node->setPixels(nullptr);
             node->setDecision(bestDecision);
 
-            // Distribute the pixels to left and right node.
-            node->setLeft(std::move(std::make_unique<Node>(bestLeftPixels, bestLeftProbabilities, node)));
-            node->setRight(std::move(std::make_unique<Node>(bestRightPixels, bestRightProbabilities, node)));
+            std::vector<float> leftProbabilities, rightProbabilities;
+            getProbabilities(bestLeftCounts, leftProbabilities);
+            getProbabilities(bestRightCounts, rightProbabilities);
+            node->setLeft(std::move(std::make_unique<Node>(bestLeftPixels, leftProbabilities, node)));
+            node->setRight(std::move(std::make_unique<Node>(bestRightPixels, rightProbabilities, node)));
             node = node->getLeft();
+            nodeID = 2 * nodeID;
             ++depth;
+            memory.release(data.allPixels->getMemorySize());
             delete data.allPixels;
         }
-        // Pixels no longer needed
-        delete data.leftPixels;
-        delete data.rightPixels;
+        memory.release(directionsMemory);
+        metrics.seconds = getSecondsSince(beginTime);
+        nodeMetrics.push_back(metrics);
+    }
+
+    return true;
+}
+
+void
+DecisionTree::refitLeaves(const LeafCounts &counts)
+{
+    std::vector<Node *> nodes;
+    if (_root.get() != nullptr)
+        nodes.push_back(_root.get());
+
+    std::vector<float> probabilities;
+    while (!nodes.empty()) {
+        Node *node = nodes.back();
+        nodes.pop_back();
+
+        if (!node->isLeaf()) {
+            nodes.push_back(node->getLeft());
+            nodes.push_back(node->getRight());
+            continue;
+        }
+
+        auto it = counts.find(node);
+        if (it != counts.cend() && getCountsSum(it->second) != 0) {
+            getProbabilities(it->second, probabilities);
+            node->setProbabilities(probabilities);
+        }
+    }
+}
+
+void
+DecisionTree::getSize(size_t &nodes, size_t &leaves, int &depth) const
+{
+    nodes = 0;
+    leaves = 0;
+    depth = 0;
+
+    std::vector<std::pair<const Node *, int> > stack;
+    if (_root.get() != nullptr)
+        stack.push_back(std::make_pair(_root.get(), 1));
+
+    while (!stack.empty()) {
+        const Node *node = stack.back().first;
+        int nodeDepth = stack.back().second;
+        stack.pop_back();
+
+        ++nodes;
+        depth = std::max(depth, nodeDepth);
+        if (node->isLeaf()) {
+            ++leaves;
+            continue;
+        }
+
+        stack.push_back(std::make_pair(node->getLeft(), nodeDepth + 1));
+        stack.push_back(std::make_pair(node->getRight(), nodeDepth + 1));
     }
 }
 
@@ -471,154 +426,8 @@ DecisionTree::readFromFile(std::ifstream & file)
     }
 }
 
-#ifdef USE_GPU
-float
-DecisionTree::evaluateNode(Node *node, NodeTrainingData &data, const std::vector<cv::Mat> &depthImages, TreeTrainGPUContext *gpuContext)
-{
-    int imgsProcessed = 0;
-    int imgPixels = depthImages[0].cols*depthImages[0].rows;
-    std::vector<float> imageData;
-    imageData.resize(gpuContext->maxImages*imgPixels);
-    data.leftPixels->clear();
-    data.rightPixels->clear();
-    data.leftPixels->reserve(data.allPixels->size());
-    data.rightPixels->reserve(data.allPixels->size());
-    auto itp = data.allPixels->begin();
-    cl_int err;
-    while (imgsProcessed < data.imageIDs.size()) {
-        int constraint = std::min(static_cast<int>(data.imageIDs.size() - imgsProcessed), gpuContext->maxImages);
-        int problemSize = 0;
-        for (int i = 0; i < constraint; ++i) {
-            int imgIndex = data.imageIDs[i];
-            problemSize += data.imagesPixelCount[i];
-            memcpy(imageData.data() + i*imgPixels, depthImages[imgIndex].data, imgPixels*sizeof(float));
-        }
-        cl::Image2DArray depthArray = cl::Image2DArray(
-            gpuContext->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-            cl::ImageFormat(CL_R, CL_FLOAT), constraint, depthImages[0].cols, depthImages[0].rows,
-            0, 0, imageData.data(), &err);
-        if (err != CL_SUCCESS) {
-            std::cout << "img error " << err
-                << " width " << depthImages[0].cols << " height " << depthImages[0].rows << std::endl;
-            exit(-1);
-        }
-        err = gpuContext->getFeatureTrain.setArg(0, depthArray);
-        if (err != CL_SUCCESS) {
-            std::cout << "Set depth array err: \n" << err << std::endl;
-            exit(-1);
-        }
-
-        err = gpuContext->getFeatureTrain.setArg(3, gpuContext->bufferSplit);
-        if (err != CL_SUCCESS) {
-            std::cout << "Set split buffer err: \n" << err << std::endl;
-            exit(-1);
-        }
-
-        err = gpuContext->getFeatureTrain.setArg(4, sizeof(cl_int), &imgsProcessed);
-        if (err != CL_SUCCESS) {
-            std::cout << "Set imgs processed err: \n" << err << std::endl;
-            exit(-1);
-        }
-
-        err = gpuContext->queue.enqueueNDRangeKernel(
-            gpuContext->getFeatureTrain,
-            cl::NullRange,
-            cl::NDRange(problemSize),
-            cl::NullRange);
-        if (err != CL_SUCCESS) {
-            std::cout << "NDRange for feature err: \n" << err << std::endl;
-            exit(-1);
-        }
-
-        std::vector<cl_char> split(problemSize);
-        err = gpuContext->queue.enqueueReadBuffer(gpuContext->bufferSplit, CL_TRUE, 0,
-                                                  sizeof(cl_char)*problemSize, split.data());
-        if (err != CL_SUCCESS) {
-            std::cout << "read split error " << err << std::endl;
-            exit(-1);
-        }
-
-        for (auto its = split.cbegin(); its != split.cend(); ++its, ++itp) {
-            if (*its == -1)
-                data.leftPixels->push_back(*itp);
-            else
-                data.rightPixels->push_back(*itp);
-        }
-
-        imgsProcessed += constraint;
-    }
-
-    if (data.leftPixels->empty() || data.rightPixels->empty()) {
-        return -std::numeric_limits<float>::infinity();
-    }
-
-    getProbabilities(data.leftPixels, data.leftProbabilities, gpuContext);
-    getProbabilities(data.rightPixels, data.rightProbabilities, gpuContext);
-
-    float allShanon = getShannonEntropy(data.allProbabilities);
-    float leftEntropy = static_cast<float>(data.leftPixels->size())/data.allPixels->size() *
-        getShannonEntropy(data.leftProbabilities);
-    float rightEntropy = static_cast<float>(data.rightPixels->size())/data.allPixels->size() *
-        getShannonEntropy(data.rightProbabilities);
-
-
-    return  -allShanon - leftEntropy - rightEntropy;
-}
-
-
-void
-DecisionTree::getProbabilities(const std::vector<Pixel> *pixels, std::vector<float> &probabilities, TreeTrainGPUContext *gpuContext)
-{
-    cl_int err = gpuContext->queue.enqueueFillBuffer<cl_uint>(gpuContext->bufferPixCount, 0, 0,
-                                                              sizeof(cl_uint)*grlHandIndexNum);
-    if (err != CL_SUCCESS) {
-        std::cout << "Fill index num err: \n" << err << std::endl;
-        exit(-1);
-    }
-    err = gpuContext->queue.enqueueWriteBuffer(gpuContext->bufferPix, CL_TRUE, 0,
-                                               sizeof(Pixel)*pixels->size(), pixels->data());
-    if (err != CL_SUCCESS) {
-        std::cout << "Set depth array err: \n" << err << std::endl;
-        exit(-1);
-    }
-    err = gpuContext->getProbabilities.setArg(0, gpuContext->bufferPix);
-    if (err != CL_SUCCESS) {
-        std::cout << "Set arg buffer pix err: \n" << err << std::endl;
-        exit(-1);
-    }
-    err = gpuContext->getProbabilities.setArg(1, gpuContext->bufferPixCount);
-    if (err != CL_SUCCESS) {
-        std::cout << "Set arg buffer pix count: \n" << err << std::endl;
-        exit(-1);
-    }
-    err = gpuContext->queue.enqueueNDRangeKernel(
-        gpuContext->getProbabilities,
-        cl::NullRange,
-        cl::NDRange(pixels->size()),
-        cl::NullRange);
-    if (err != CL_SUCCESS) {
-        std::cout << "NDRange for prob error: \n" << err << std::endl;
-        exit(-1);
-    }
-
-    std::vector<cl_uint> countResults(grlHandIndexNum);
-    err = gpuContext->queue.enqueueReadBuffer(gpuContext->bufferPixCount, CL_TRUE, 0,
-                                              sizeof(cl_uint)*grlHandIndexNum, countResults.data());
-    if (err != CL_SUCCESS) {
-        std::cout << "Reading pix count error: \n" << err << std::endl;
-        exit(-1);
-    }
-    probabilities.resize(grlHandIndexNum);
-    // Normalize the probabilities
-    size_t sum = pixels->size();
-    auto itc = countResults.cbegin();
-    for (auto itp = probabilities.begin(); itp != probabilities.end(); ++itp, ++itc)
-        (*itp) = (*itc)/static_cast<float>(sum);
-}
-#endif
-
 const std::vector<float> &
-DecisionTree::classifyPixel(const cv::Mat &depthImage, const Pixel &p)
+DecisionTree::classifyPixel(const cv::Mat &depthImage, const Pixel &p) const
 {
     const Node *leaf = _root->getLeafForPixel(depthImage, p);
 
@@ -0,0 +1,62 @@
+#include <grl/rdf/Entropy.h>
+
+#include <cassert>
+
+namespace grl {
+
+constexpr uint32_t EntropyTable::tableSize;
+
+EntropyTable::EntropyTable()
+    : _table(tableSize)
+{
+    _table[0] = 0.0;
+    for (uint32_t n = 1; n < tableSize; ++n)
+        _table[n] = n * std::log2(static_cast<double>(n));
+}
+
+const EntropyTable &
+EntropyTable::getInstance()
+{
+    static const EntropyTable table;
+    return table;
+}
+
+double
+EntropyTable::getScaledEntropy(const ClassCounts &counts) const
+{
+    uint32_t sum = 0;
+    double sumNLog2N = 0.0;
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+        sum += *it;
+        sumNLog2N += nlog2n(*it);
+    }
+
+    return nlog2n(sum) - sumNLog2N;
+}
+
+double
+EntropyTable::getGain(const ClassCounts &parent, const ClassCounts &left) const
+{
+    uint32_t parentSum = 0;
+    uint32_t leftSum = 0;
+    double parentNLog2N = 0.0;
+    double childrenNLog2N = 0.0;
+    for (size_t i = 0; i < parent.size(); ++i) {
+        assert(left[i] <= parent[i]);
+        parentSum += parent[i];
+        leftSum += left[i];
+        parentNLog2N += nlog2n(parent[i]);
+        childrenNLog2N += nlog2n(left[i]) + nlog2n(parent[i] - left[i]);
+    }
+
+    if (parentSum == 0)
+        return 0.0;
+
+    // N*H(P) - |L|*H(L) - |R|*H(R)
+    double scaledGain = (nlog2n(parentSum) - parentNLog2N)
+                      - (nlog2n(leftSum) + nlog2n(parentSum - leftSum) - childrenNLog2N);
+
+    return scaledGain / parentSum;
+}
+
+}
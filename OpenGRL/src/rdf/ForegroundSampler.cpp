@@ -0,0 +1,129 @@
+#include <grl/rdf/ForegroundSampler.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace grl {
+
+void
+ForegroundSampler::build(const cv::Mat &classImage)
+{
+    assert(classImage.type() == CV_8SC1);
+
+    _cols = classImage.cols;
+    _pixels.clear();
+    _classStart.fill(0);
+
+    // Counting sort by class - first count the pixels of each class...
+    std::array<uint32_t, grlHandIndexNum> counts = {};
+    for (int y = 0; y < classImage.rows; ++y) {
+        const int8_t *row = classImage.ptr<int8_t>(y);
+        for (int x = 0; x < classImage.cols; ++x) {
+            if (row[x] >= grlHandIndexStart && row[x] < grlHandIndexNum)
+                ++counts[row[x]];
+        }
+    }
+
+    for (int c = 0; c < grlHandIndexNum; ++c)
+        _classStart[c + 1] = _classStart[c] + counts[c];
+
+    // ...then put them in their places
+    std::array<uint32_t, grlHandIndexNum> next;
+    std::copy(_classStart.begin(), _classStart.end() - 1, next.begin());
+    _pixels.resize(_classStart[grlHandIndexNum]);
+    for (int y = 0; y < classImage.rows; ++y) {
+        const int8_t *row = classImage.ptr<int8_t>(y);
+        uint32_t base = static_cast<uint32_t>(y * classImage.cols);
+        for (int x = 0; x < classImage.cols; ++x) {
+            if (row[x] >= grlHandIndexStart && row[x] < grlHandIndexNum)
+                _pixels[next[row[x]]++] = base + x;
+        }
+    }
+}
+
+void
+ForegroundSampler::sample(size_t n, bool stratified, RandomStream &stream,
+                          std::vector<cv::Point> &samples, std::vector<uint32_t> &scratch) const
+{
+    size_t remaining = std::min(n, _pixels.size());
+    if (remaining == 0)
+        return;
+
+    samples.reserve(samples.size() + remaining);
+
+    if (!stratified) {
+        drawRange(0, _pixels.size(), remaining, stream, samples, scratch);
+        return;
+    }
+
+    // Visit the classes from the smallest one, so the share that the small
+    // classes cannot fill is passed on to the bigger ones.
+    std::array<int, grlHandIndexNum> order;
+    size_t nclasses = 0;
+    for (int c = 0; c < grlHandIndexNum; ++c) {
+        if (_classStart[c + 1] > _classStart[c])
+            order[nclasses++] = c;
+    }
+    std::stable_sort(order.begin(), order.begin() + nclasses, [this](int a, int b) {
+        return getClassSize(a) < getClassSize(b);
+    });
+
+    for (size_t i = 0; i < nclasses; ++i) {
+        int c = order[i];
+        size_t classesLeft = nclasses - i;
+        size_t share = (remaining + classesLeft - 1) / classesLeft;
+        size_t taken = std::min(share, getClassSize(c));
+
+        drawRange(_classStart[c], _classStart[c + 1], taken, stream, samples, scratch);
+        remaining -= taken;
+    }
+
+    assert(remaining == 0);
+}
+
+void
+ForegroundSampler::drawRange(size_t first, size_t last, size_t n, RandomStream &stream,
+                             std::vector<cv::Point> &samples, std::vector<uint32_t> &scratch) const
+{
+    size_t size = last - first;
+    n = std::min(n, size);
+
+    // The whole range is taken in order, nothing to shuffle
+    if (n == size) {
+        for (size_t i = first; i < last; ++i)
+            samples.push_back(cv::Point(_pixels[i] % _cols, _pixels[i] / _cols));
+        return;
+    }
+
+    // The list is shared between the trees, so the positions in the range are
+    // shuffled instead of the pixels. The beginning of scratch is the identity
+    // permutation of the positions, which is the same for every range, so it
+    // is only extended when the range is bigger. The targets of the n swaps
+    // are stored after it and the swaps are undone in the reverse order.
+    // The pixels are read only after the shuffle, so the reads from the list,
+    // which is usually not in the cache, do not wait for each other.
+    size_t identitySize = scratch.size();
+    if (identitySize < size) {
+        scratch.resize(size);
+        for (size_t i = identitySize; i < size; ++i)
+            scratch[i] = static_cast<uint32_t>(i);
+        identitySize = size;
+    }
+    scratch.resize(identitySize + n);
+    uint32_t *positions = scratch.data();
+    uint32_t *swaps = positions + identitySize;
+    const uint32_t *range = _pixels.data() + first;
+    for (size_t i = 0; i < n; ++i) {
+        swaps[i] = static_cast<uint32_t>(i + stream.uniformIndex(static_cast<uint32_t>(size - i)));
+        std::swap(positions[i], positions[swaps[i]]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t pixel = range[positions[i]];
+        samples.push_back(cv::Point(pixel % _cols, pixel / _cols));
+    }
+    for (size_t i = n; i-- > 0;)
+        std::swap(positions[i], positions[swaps[i]]);
+    scratch.resize(identitySize);
+}
+
+}
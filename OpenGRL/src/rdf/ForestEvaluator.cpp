@@ -0,0 +1,179 @@
+#include <grl/rdf/ForestEvaluator.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace grl {
+
+static double
+getSecondsSince(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+bool
+ForestEvaluator::evaluate(const std::vector<cv::Mat> &classImages,
+                          const std::vector<cv::Mat> &depthImages,
+                          const std::vector<size_t> &poses, size_t nthreads)
+{
+    if (classImages.size() != depthImages.size() ||
+        (!poses.empty() && poses.size() != depthImages.size())) {
+        std::cerr << "Number of class images, depth images and poses does not match" << std::endl;
+        return false;
+    }
+
+    for (auto it = _confusion.begin(); it != _confusion.end(); ++it)
+        it->fill(0);
+    _poses.clear();
+    _latencies.assign(depthImages.size(), 0.0);
+    _pixels = 0;
+
+    // Without OpenMP the images are classified one after another
+#ifdef _OPENMP
+    int threads = nthreads == 0 ? omp_get_max_threads() : static_cast<int>(nthreads);
+#endif
+    auto beginTime = std::chrono::steady_clock::now();
+
+#pragma omp parallel num_threads(threads)
+    {
+        // Each thread counts on its own and merges once at the end
+        ConfusionMatrix confusion = {};
+        std::map<size_t, std::pair<uint64_t, uint64_t>> poseStats;
+        uint64_t pixels = 0;
+        cv::Mat foundClasses;
+        ClassesWeights weights;
+        ClassesPoints points;
+
+#pragma omp for schedule(dynamic)
+        for (int i = 0; i < static_cast<int>(depthImages.size()); ++i) {
+            auto imageTime = std::chrono::steady_clock::now();
+            _forest.classifyImage(depthImages[i], foundClasses, weights, points);
+            _latencies[i] = getSecondsSince(imageTime);
+
+            std::pair<uint64_t, uint64_t> &pose = poseStats[poses.empty() ? 0 : poses[i]];
+            const cv::Mat &classImage = classImages[i];
+            for (int y = 0; y < foundClasses.rows; ++y) {
+                const int8_t *foundRow = foundClasses.ptr<int8_t>(y);
+                const int8_t *referenceRow = classImage.ptr<int8_t>(y);
+                for (int x = 0; x < foundClasses.cols; ++x) {
+                    size_t found = toEvaluationClass(foundRow[x]);
+                    size_t reference = toEvaluationClass(referenceRow[x]);
+                    if (found == grlEvaluationBackground && reference == grlEvaluationBackground)
+                        continue;
+
+                    ++confusion[reference][found];
+                    if (found == grlEvaluationBackground)
+                        continue;
+                    ++pixels;
+                    ++pose.second;
+                    if (found == reference)
+                        ++pose.first;
+                }
+            }
+        }
+
+#pragma omp critical
+        {
+            for (size_t r = 0; r < grlEvaluationClassesNum; ++r) {
+                for (size_t c = 0; c < grlEvaluationClassesNum; ++c)
+                    _confusion[r][c] += confusion[r][c];
+            }
+            for (auto it = poseStats.cbegin(); it != poseStats.cend(); ++it) {
+                std::pair<uint64_t, uint64_t> &pose = _poses[it->first];
+                pose.first += it->second.first;
+                pose.second += it->second.second;
+            }
+            _pixels += pixels;
+        }
+    }
+
+    _seconds = getSecondsSince(beginTime);
+    std::sort(_latencies.begin(), _latencies.end());
+
+    return true;
+}
+
+double
+ForestEvaluator::getAccuracy() const
+{
+    uint64_t matched = 0;
+    uint64_t total = 0;
+    for (auto it = _poses.cbegin(); it != _poses.cend(); ++it) {
+        matched += it->second.first;
+        total += it->second.second;
+    }
+
+    return total > 0 ? static_cast<double>(matched) / total : 0.0;
+}
+
+double
+ForestEvaluator::getPoseAccuracy(size_t pose) const
+{
+    auto it = _poses.find(pose);
+    if (it == _poses.cend() || it->second.second == 0)
+        return 0.0;
+
+    return static_cast<double>(it->second.first) / it->second.second;
+}
+
+double
+ForestEvaluator::getPixelsPerSecond() const
+{
+    return _seconds > 0.0 ? _pixels / _seconds : 0.0;
+}
+
+double
+ForestEvaluator::getLatency(double percentile) const
+{
+    if (_latencies.empty())
+        return 0.0;
+
+    // Nearest rank
+    double rank = std::ceil(percentile / 100.0 * _latencies.size());
+    size_t i = rank < 1.0 ? 0 : static_cast<size_t>(rank) - 1;
+
+    return _latencies[std::min(i, _latencies.size() - 1)];
+}
+
+void
+ForestEvaluator::print(std::ostream &out) const
+{
+    out << "Evaluated " << getImagesNum() << " images, " << _pixels << " pixels in "
+        << _seconds << " s" << std::endl;
+    out << "Accuracy " << getAccuracy() * 100.0 << "%, " << getPixelsPerSecond()
+        << " pixels/s, latency p50 " << getLatency(50.0) * 1000.0
+        << " ms, p99 " << getLatency(99.0) * 1000.0 << " ms" << std::endl;
+
+    for (auto it = _poses.cbegin(); it != _poses.cend(); ++it) {
+        out << "Pose " << it->first << ": matched " << it->second.first << "/"
+            << it->second.second << " " << getPoseAccuracy(it->first) * 100.0 << "%" << std::endl;
+    }
+
+    // Rows are the reference classes, BG is the background
+    out << "Confusion matrix (rows - reference, columns - found):" << std::endl;
+    out << std::setw(4) << "";
+    for (size_t c = 0; c < grlEvaluationClassesNum; ++c) {
+        if (c == grlEvaluationBackground)
+            out << std::setw(9) << "BG";
+        else
+            out << std::setw(9) << c;
+    }
+    out << std::endl;
+    for (size_t r = 0; r < grlEvaluationClassesNum; ++r) {
+        if (r == grlEvaluationBackground)
+            out << std::setw(4) << "BG";
+        else
+            out << std::setw(4) << r;
+        for (size_t c = 0; c < grlEvaluationClassesNum; ++c)
+            out << std::setw(9) << _confusion[r][c];
+        out << std::endl;
+    }
+}
+
+}
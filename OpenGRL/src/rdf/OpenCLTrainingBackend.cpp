@@ -0,0 +1,241 @@
+#ifdef USE_GPU
+#include <grl/rdf/OpenCLTrainingBackend.h>
+#include <grl/rdf/DecisionTree.h>
+
+#include <fstream>
+#include <sstream>
+
+namespace grl {
+
+bool
+OpenCLTrainingBackend::buildProgram(ForestTrainGPUContext &gpuContext, std::string &error)
+{
+    std::ifstream file("rdf.cl");
+    if (!file.is_open()) {
+        error = "Cannot open rdf.cl";
+        return false;
+    }
+    std::string kernels((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    cl::Program::Sources sources;
+    sources.push_back({kernels.c_str(), kernels.length()});
+
+    gpuContext.program = cl::Program(gpuContext.context, sources);
+    if (gpuContext.program.build({gpuContext.device}) != CL_SUCCESS) {
+        error = "Failed to build sources: " +
+            gpuContext.program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(gpuContext.device);
+        return false;
+    }
+
+    return true;
+}
+
+bool
+OpenCLTrainingBackend::checkError(cl_int err, const char *what)
+{
+    if (err == CL_SUCCESS)
+        return true;
+
+    std::ostringstream message;
+    message << what << " failed with OpenCL error " << err;
+    return setError(message.str());
+}
+
+void
+OpenCLTrainingBackend::toPixels(const TrainingPixels &pixels, std::vector<Pixel> &dst)
+{
+    const int16_t *xs = pixels.getX();
+    const int16_t *ys = pixels.getY();
+    const float *invDepths = pixels.getInvDepth();
+    const uint32_t *imageIDs = pixels.getImageIDs();
+    const int8_t *classes = pixels.getClasses();
+
+    dst.resize(pixels.size());
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        dst[i].coords.x = xs[i];
+        dst[i].coords.y = ys[i];
+        dst[i].depth = 1.0f / invDepths[i];
+        dst[i].imgID = imageIDs[i];
+        dst[i].classIndex = classes[i];
+    }
+}
+
+bool
+OpenCLTrainingBackend::init(const ForestTrainGPUContext &gpuContext, size_t maxPixels)
+{
+    cl_int err = CL_SUCCESS;
+
+    _context = gpuContext.context;
+    _maxImages = gpuContext.maxImages;
+    _maxPixels = maxPixels;
+    _queue = cl::CommandQueue(_context, gpuContext.device, 0, &err);
+    if (!checkError(err, "Creating the queue"))
+        return false;
+
+    _bufferAllPix = cl::Buffer(_context, CL_MEM_READ_ONLY, sizeof(Pixel)*maxPixels, nullptr, &err);
+    if (!checkError(err, "Allocating the pixels buffer"))
+        return false;
+    _bufferSplit = cl::Buffer(_context, CL_MEM_WRITE_ONLY, sizeof(cl_char)*maxPixels, nullptr, &err);
+    if (!checkError(err, "Allocating the split buffer"))
+        return false;
+    _bufferPix = cl::Buffer(_context, CL_MEM_READ_ONLY, sizeof(Pixel)*maxPixels, nullptr, &err);
+    if (!checkError(err, "Allocating the counted pixels buffer"))
+        return false;
+    _bufferPixCount = cl::Buffer(_context, CL_MEM_READ_WRITE, sizeof(cl_uint)*grlHandIndexNum, nullptr, &err);
+    if (!checkError(err, "Allocating the counts buffer"))
+        return false;
+
+    _getFeatureTrain = cl::Kernel(gpuContext.program, "getFeatureTrain", &err);
+    if (!checkError(err, "Creating getFeatureTrain kernel"))
+        return false;
+    _getProbabilities = cl::Kernel(gpuContext.program, "getProbabilities", &err);
+    if (!checkError(err, "Creating getProbabilities kernel"))
+        return false;
+
+    return true;
+}
+
+bool
+OpenCLTrainingBackend::setNodePixels(const TrainingPixels &pixels,
+                                     const std::vector<cv::Mat> &depthImages)
+{
+    if (pixels.size() > _maxPixels)
+        return setError("Node has more pixels than the buffers can hold");
+
+    _depthImages = &depthImages;
+    toPixels(pixels, _pixels);
+    cl_int err = _queue.enqueueWriteBuffer(_bufferAllPix, CL_TRUE, 0,
+                                           sizeof(Pixel)*_pixels.size(), _pixels.data());
+    if (!checkError(err, "Writing the node pixels"))
+        return false;
+    err = _getFeatureTrain.setArg(1, _bufferAllPix);
+    if (!checkError(err, "Setting the node pixels"))
+        return false;
+
+    // Get all images ids which should be analyzed, the pixels are grouped
+    // by the image
+    _imageIDs.clear();
+    _imagesPixelCount.clear();
+    const uint32_t *imageIDs = pixels.getImageIDs();
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        if (_imageIDs.empty() || _imageIDs.back() != imageIDs[i]) {
+            _imageIDs.push_back(imageIDs[i]);
+            _imagesPixelCount.push_back(1);
+        } else {
+            ++_imagesPixelCount.back();
+        }
+    }
+
+    return true;
+}
+
+bool
+OpenCLTrainingBackend::evaluateDecision(const Decision &decision,
+                                        const TrainingPixels &pixels,
+                                        std::vector<uint8_t> &directions,
+                                        ClassCounts &leftCounts)
+{
+    if (_depthImages == nullptr)
+        return setError("Node pixels were not set");
+    const std::vector<cv::Mat> &depthImages = *_depthImages;
+    const int8_t *classes = pixels.getClasses();
+
+    cl_int err = _getFeatureTrain.setArg(2, sizeof(Decision), &decision);
+    if (!checkError(err, "Setting the decision"))
+        return false;
+
+    int imgPixels = depthImages[0].cols*depthImages[0].rows;
+    _imageData.resize(_maxImages*imgPixels);
+    directions.resize(pixels.size());
+    leftCounts.fill(0);
+
+    size_t imgsProcessed = 0;
+    size_t pixelsProcessed = 0;
+    while (imgsProcessed < _imageIDs.size()) {
+        int constraint = std::min(static_cast<int>(_imageIDs.size() - imgsProcessed), _maxImages);
+        int problemSize = 0;
+        for (int i = 0; i < constraint; ++i) {
+            uint32_t imgIndex = _imageIDs[imgsProcessed + i];
+            problemSize += _imagesPixelCount[imgsProcessed + i];
+            memcpy(_imageData.data() + i*imgPixels, depthImages[imgIndex].data, imgPixels*sizeof(float));
+        }
+        cl::Image2DArray depthArray = cl::Image2DArray(
+            _context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+            cl::ImageFormat(CL_R, CL_FLOAT), constraint, depthImages[0].cols, depthImages[0].rows,
+            0, 0, _imageData.data(), &err);
+        if (!checkError(err, "Creating the depth images"))
+            return false;
+
+        // The kernel gets the layer of the image from the id of the first one
+        cl_int idOffset = static_cast<cl_int>(_imageIDs[imgsProcessed]);
+        if (!checkError(_getFeatureTrain.setArg(0, depthArray), "Setting the depth images") ||
+            !checkError(_getFeatureTrain.setArg(3, _bufferSplit), "Setting the split buffer") ||
+            !checkError(_getFeatureTrain.setArg(4, sizeof(cl_int), &idOffset), "Setting the image offset"))
+            return false;
+
+        err = _queue.enqueueNDRangeKernel(
+            _getFeatureTrain,
+            cl::NDRange(pixelsProcessed),
+            cl::NDRange(problemSize),
+            cl::NullRange);
+        if (!checkError(err, "Running getFeatureTrain"))
+            return false;
+
+        _split.resize(problemSize);
+        err = _queue.enqueueReadBuffer(_bufferSplit, CL_TRUE, sizeof(cl_char)*pixelsProcessed,
+                                       sizeof(cl_char)*problemSize, _split.data());
+        if (!checkError(err, "Reading the split"))
+            return false;
+
+        for (int i = 0; i < problemSize; ++i) {
+            size_t index = pixelsProcessed + i;
+            if (_split[i] == -1) {
+                directions[index] = grlNodeGoLeft;
+                ++leftCounts[classes[index]];
+            } else {
+                directions[index] = grlNodeGoRight;
+            }
+        }
+
+        imgsProcessed += constraint;
+        pixelsProcessed += problemSize;
+    }
+
+    return true;
+}
+
+bool
+OpenCLTrainingBackend::getClassCounts(const TrainingPixels &pixels, ClassCounts &counts)
+{
+    if (pixels.size() > _maxPixels)
+        return setError("Node has more pixels than the buffers can hold");
+
+    toPixels(pixels, _pixels);
+    cl_int err = _queue.enqueueFillBuffer<cl_uint>(_bufferPixCount, 0, 0,
+                                                   sizeof(cl_uint)*grlHandIndexNum);
+    if (!checkError(err, "Clearing the counts"))
+        return false;
+    err = _queue.enqueueWriteBuffer(_bufferPix, CL_TRUE, 0,
+                                    sizeof(Pixel)*_pixels.size(), _pixels.data());
+    if (!checkError(err, "Writing the counted pixels"))
+        return false;
+    if (!checkError(_getProbabilities.setArg(0, _bufferPix), "Setting the counted pixels") ||
+        !checkError(_getProbabilities.setArg(1, _bufferPixCount), "Setting the counts"))
+        return false;
+
+    err = _queue.enqueueNDRangeKernel(
+        _getProbabilities,
+        cl::NullRange,
+        cl::NDRange(pixels.size()),
+        cl::NullRange);
+    if (!checkError(err, "Running getProbabilities"))
+        return false;
+
+    static_assert(sizeof(cl_uint) == sizeof(ClassCounts::value_type), "Counts must match the kernel");
+    err = _queue.enqueueReadBuffer(_bufferPixCount, CL_TRUE, 0,
+                                   sizeof(cl_uint)*grlHandIndexNum, counts.data());
+    return checkError(err, "Reading the counts");
+}
+
+}
+#endif // USE_GPU
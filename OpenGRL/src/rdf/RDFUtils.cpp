@@ -1,9 +1,11 @@
 #include <grl/rdf/RDFUtils.h>
 #include <grl/utils/RGBTools.h>
+#include <grl/utils/ThreadPool.h>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include <cassert>
 #include <iomanip>
 #include <iostream>
 
@@ -60,27 +62,95 @@ void RDFTools::convertBlenderDepthToGeneric(const cv::Mat &src, cv::Mat &dst)
         *dstData = (*it)[0] / 10.0f; 
 }
 
+RDFTools::ColorLookup::ColorLookup()
+{
+    // Start from the Knuth's multiplicative hash and try next odd multipliers
+    // until all of the colors land in the separate slots.
+    for (multiplier = 2654435761u; ; multiplier += 2) {
+        keys.fill(emptyKey);
+        bool collision = false;
+        int8_t index = -grlHandIndexOffset;
+        for (auto it = classColors.cbegin(); it != classColors.cend(); ++it, ++index) {
+            uint32_t h = hash(*it);
+            if (keys[h] != emptyKey) {
+                collision = true;
+                break;
+            }
+            keys[h] = *it;
+            classes[h] = index;
+        }
+        if (!collision)
+            break;
+    }
+}
+
+const RDFTools::ColorLookup &
+RDFTools::getColorLookup()
+{
+    static const ColorLookup lookup;
+    return lookup;
+}
+
+int8_t RDFTools::rgbToHandClass(uint32_t rgb)
+{
+    return getColorLookup()(rgb);
+}
+
 void RDFTools::convertRGBToHandClasses(const cv::Mat &src, cv::Mat &dst)
 {
+    assert(src.type() == CV_8UC3);
+    const ColorLookup &lookup = getColorLookup();
+
     dst = cv::Mat(src.rows, src.cols, CV_8SC1);
-    int8_t *dstData = reinterpret_cast<int8_t *>(dst.data);
-
-    cv::MatConstIterator_<cv::Vec3b> it, end;
-    for (it = src.begin<cv::Vec3b>(); it != src.end<cv::Vec3b>(); ++it, ++dstData) {
-        int8_t index = 0;
-        uint8_t b = (*it)[0];
-        uint8_t g = (*it)[1];
-        uint8_t r = (*it)[2];
-        for (auto itc = classColors.begin(); itc != classColors.end(); ++itc, ++index) {
-            if (compareRGBwithVal(*itc, b, g, r))
-                break;
+    for (int y = 0; y < src.rows; ++y) {
+        const uint8_t *bgr = src.ptr<uint8_t>(y);
+        int8_t *dstData = dst.ptr<int8_t>(y);
+        for (int x = 0; x < src.cols; ++x, bgr += 3)
+            dstData[x] = lookup((bgr[2] << colorRShift) | (bgr[1] << colorGShift) | bgr[0]);
+    }
+}
+
+cv::Rect RDFTools::convertRGBToHandClassesCropped(const cv::Mat &src, cv::Mat &dst)
+{
+    assert(src.type() == CV_8UC3);
+    const ColorLookup &lookup = getColorLookup();
+
+    cv::Mat classes(src.rows, src.cols, CV_8SC1);
+    int rmin = src.rows, rmax = -1;
+    int cmin = src.cols, cmax = -1;
+    for (int y = 0; y < src.rows; ++y) {
+        const uint8_t *bgr = src.ptr<uint8_t>(y);
+        int8_t *classesData = classes.ptr<int8_t>(y);
+        // First and last non-black pixel in the row
+        int first = src.cols, last = -1;
+        for (int x = 0; x < src.cols; ++x, bgr += 3) {
+            uint32_t rgb = (bgr[2] << colorRShift) | (bgr[1] << colorGShift) | bgr[0];
+            classesData[x] = lookup(rgb);
+            if (rgb != grlBackgroundColor) {
+                if (first > x) first = x;
+                last = x;
+            }
+        }
+
+        if (last >= 0) {
+            if (rmin > y) rmin = y;
+            rmax = y;
+            if (cmin > first) cmin = first;
+            if (cmax < last) cmax = last;
         }
-        index -= grlHandIndexOffset;
-        if (index >= grlHandIndexNum)
-            *dstData = grlUnknownIndex;
-        else
-            *dstData = index;
     }
+
+    if (rmax < 0) {
+        dst = cv::Mat();
+        return cv::Rect();
+    }
+
+    // Keep the same box as getBoundingBoxRGB, so the training data does not
+    // change.
+    cv::Rect bb(cv::Point2i(cmin, rmin), cv::Point2i(cmax, rmax));
+    dst = classes(bb).clone();
+
+    return bb;
 }
 
 void RDFTools::convertHandClassesToRGB(const cv::Mat &src, cv::Mat &dst)
@@ -109,12 +179,8 @@ cv::Rect RDFTools::loadDepthImageWithClasses(
     cv::Mat &depthImage)
 {
     cv::Mat classRGBImage = cv::imread(className);
-    // Get ROI
-    cv::Rect bb = getBoundingBoxRGB(classRGBImage);
-
-    // Convert ROI
-    cv::Mat classRGBImageROI = classRGBImage(bb);
-    convertRGBToHandClasses(classRGBImageROI, classImage);
+    // Get ROI and convert it
+    cv::Rect bb = convertRGBToHandClassesCropped(classRGBImage, classImage);
 
     cv::Mat depth3CImage = cv::imread(depthName, cv::IMREAD_UNCHANGED);
 
@@ -126,6 +192,35 @@ cv::Rect RDFTools::loadDepthImageWithClasses(
     return bb;
 }
 
+std::string RDFTools::getImageName(const std::string &baseName, size_t i,
+                                   uint8_t nameDigits, const char *extension)
+{
+    std::ostringstream ss;
+    ss << baseName << std::setfill('0') << std::setw(nameDigits) << i << extension;
+
+    return ss.str();
+}
+
+void RDFTools::alignImagesToCommonSize(cv::Size sizeMax,
+                                       std::vector<cv::Mat> &classImages,
+                                       std::vector<cv::Mat> &depthImages)
+{
+    std::cout << "Old width and height " << sizeMax.width << "," << sizeMax.height << std::endl;
+    sizeMax.width = static_cast<int>(pow(2, ceil(log(sizeMax.width)/log(2))));
+    sizeMax.height = static_cast<int>(pow(2, ceil(log(sizeMax.height)/log(2))));
+
+    std::cout << "New width and height " << sizeMax.width << "," << sizeMax.height << std::endl;
+
+    // Align all images to the common size (for GPU computing)
+    for (auto itc = classImages.begin(), itd = depthImages.begin(); itc != classImages.end(); ++itd, ++itc) {
+        cv::copyMakeBorder(*itc, *itc, 0, sizeMax.height - itc->rows, 0, sizeMax.width - itc->cols,
+                           cv::BORDER_CONSTANT, cv::Scalar(grlBackgroundIndex));
+        cv::copyMakeBorder(*itd, *itd, 0, sizeMax.height - itd->rows, 0, sizeMax.width - itd->cols,
+                           cv::BORDER_CONSTANT, cv::Scalar(
+                           std::numeric_limits<float>::max()));
+    }
+}
+
 void RDFTools::loadDepthImagesWithClasses(
     size_t start,
     size_t stop,
@@ -141,33 +236,69 @@ void RDFTools::loadDepthImagesWithClasses(
     cv::Size sizeMax(0, 0);
     for (size_t i = start; i < stop; i += step) {
         printf("Image %ju\n", i);
-        std::ostringstream ssClass;
-        std::ostringstream ssDepth;
-        ssClass << className << std::setfill('0') << std::setw(nameDigits) << i << ".png";
-        ssDepth << depthName << std::setfill('0') << std::setw(nameDigits) << i << ".exr";
 
         classImages.push_back(cv::Mat());
         depthImages.push_back(cv::Mat());
-        cv::Rect bb = loadDepthImageWithClasses(ssClass.str(), ssDepth.str(), classImages.back(), depthImages.back());
+        cv::Rect bb = loadDepthImageWithClasses(getImageName(className, i, nameDigits, ".png"),
+                                                getImageName(depthName, i, nameDigits, ".exr"),
+                                                classImages.back(), depthImages.back());
 
         if (bb.width > sizeMax.width) sizeMax.width = bb.width;
         if (bb.height > sizeMax.height) sizeMax.height = bb.height;
     }
 
-    std::cout << "Old width and height " << sizeMax.width << "," << sizeMax.height << std::endl;
-    sizeMax.width = static_cast<int>(pow(2, ceil(log(sizeMax.width)/log(2))));
-    sizeMax.height = static_cast<int>(pow(2, ceil(log(sizeMax.height)/log(2))));
+    alignImagesToCommonSize(sizeMax, classImages, depthImages);
+}
 
-    std::cout << "New width and height " << sizeMax.width << "," << sizeMax.height << std::endl;
+void RDFTools::loadDepthImagesWithClassesParallel(
+    size_t start,
+    size_t stop,
+    size_t step,
+    uint8_t nameDigits,
+    const std::string &className,
+    const std::string &depthName,
+    std::vector<cv::Mat> &classImages,
+    std::vector<cv::Mat> &depthImages,
+    size_t nthreads,
+    const ImageLoadedCallback &onImageLoaded)
+{
+    size_t count = stop > start ? (stop - start + step - 1) / step : 0;
+    // The images are appended to the vectors, so the imgID starts after the
+    // images which are already there.
+    size_t first = classImages.size();
+    classImages.resize(first + count);
+    depthImages.resize(first + count);
+    std::vector<cv::Rect> boxes(count);
 
-    // Align all images to the common size (for GPU computing)
-    for (auto itc = classImages.begin(), itd = depthImages.begin(); itc != classImages.end(); ++itd, ++itc) {
-        cv::copyMakeBorder(*itc, *itc, 0, sizeMax.height - itc->rows, 0, sizeMax.width - itc->cols,
-                           cv::BORDER_CONSTANT, cv::Scalar(grlBackgroundIndex));
-        cv::copyMakeBorder(*itd, *itd, 0, sizeMax.height - itd->rows, 0, sizeMax.width - itd->cols,
-                           cv::BORDER_CONSTANT, cv::Scalar(
-                           std::numeric_limits<float>::max()));
+    // Each image is written only by the worker decoding it
+    ThreadPool pool(nthreads);
+    std::vector<std::future<void> > done;
+    done.reserve(count);
+    for (size_t n = 0; n < count; ++n) {
+        done.push_back(pool.enqueue([&, n]() {
+            size_t i = start + n*step;
+            boxes[n] = loadDepthImageWithClasses(getImageName(className, i, nameDigits, ".png"),
+                                                 getImageName(depthName, i, nameDigits, ".exr"),
+                                                 classImages[first + n], depthImages[first + n]);
+        }));
     }
+
+    // Stream the images to the consumer in the right order while the rest is
+    // being decoded. get() waits for the image and rethrows the exception if
+    // it could not be loaded, before the consumer sees it.
+    for (size_t n = 0; n < count; ++n) {
+        done[n].get();
+        if (onImageLoaded)
+            onImageLoaded(static_cast<uint32_t>(first + n), classImages[first + n], depthImages[first + n]);
+    }
+
+    cv::Size sizeMax(0, 0);
+    for (auto it = boxes.cbegin(); it != boxes.cend(); ++it) {
+        if (it->width > sizeMax.width) sizeMax.width = it->width;
+        if (it->height > sizeMax.height) sizeMax.height = it->height;
+    }
+
+    alignImagesToCommonSize(sizeMax, classImages, depthImages);
 }
 
-}
\ No newline at end of file
+}
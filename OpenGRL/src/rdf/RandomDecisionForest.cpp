@@ -1,62 +1,336 @@
 #include <grl/rdf/RDFUtils.h>
 #include <grl/rdf/RandomDecisionForest.h>
+#include <grl/utils/ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
 
 namespace grl {
 
-void
+static double
+toMegabytes(size_t bytes)
+{
+    return static_cast<double>(bytes) / (1 << 20);
+}
+
+bool
 RandomDecisionForest::train(const ForestTrainContext &context)
 {
+    return trainTrees(0, context);
+}
+
+bool
+RandomDecisionForest::appendTrees(size_t ntrees, const ForestTrainContext &context)
+{
+    size_t first = _trees.size();
+    _trees.resize(first + ntrees);
+    if (!trainTrees(first, context)) {
+        _trees.erase(_trees.begin() + first, _trees.end());
+        return false;
+    }
+
+    return true;
+}
+
+void
+RandomDecisionForest::refitLeaves(const std::vector<cv::Mat> &classImages,
+                                  const std::vector<cv::Mat> &depthImages)
+{
+    assert(classImages.size() == depthImages.size());
+
+    std::vector<LeafCounts> counts(_trees.size());
+#pragma omp parallel
+    {
+        // Each pixel is passed through all of the trees while its images
+        // are in the cache
+        std::vector<LeafCounts> tcounts(_trees.size());
+#pragma omp for schedule(dynamic)
+        for (int i = 0; i < static_cast<int>(depthImages.size()); ++i) {
+            const cv::Mat &depthImage = depthImages[i];
+            const cv::Mat &classImage = classImages[i];
+            for (short y = 0; y < depthImage.rows; ++y) {
+                const float *depthRow = depthImage.ptr<float>(y);
+                const int8_t *classRow = classImage.ptr<int8_t>(y);
+                for (short x = 0; x < depthImage.cols; ++x) {
+                    if (classRow[x] == grlBackgroundIndex ||
+                        depthRow[x] > grlDepthMaxDist || depthRow[x] < grl::epsilon)
+                        continue;
+
+                    Pixel p = { { x, y }, depthRow[x], static_cast<uint32_t>(i), classRow[x] };
+                    for (size_t t = 0; t < _trees.size(); ++t) {
+                        Node *root = _trees[t].getRoot();
+                        if (root != nullptr)
+                            ++tcounts[t][root->getLeafForPixel(depthImage, p)][classRow[x]];
+                    }
+                }
+            }
+        }
+
+#pragma omp critical
+        for (size_t t = 0; t < _trees.size(); ++t) {
+            for (auto it = tcounts[t].cbegin(); it != tcounts[t].cend(); ++it) {
+                ClassCounts &leafCounts = counts[t][it->first];
+                for (size_t c = 0; c < leafCounts.size(); ++c)
+                    leafCounts[c] += it->second[c];
+            }
+        }
+    }
+
+    for (size_t t = 0; t < _trees.size(); ++t)
+        _trees[t].refitLeaves(counts[t]);
+}
+
+bool
+RandomDecisionForest::trainTrees(size_t first, const ForestTrainContext &context)
+{
+    if (!TrainingBackend::isAvailable(context.backend)) {
+        std::cerr << "Training backend " << context.backend << " is not available\n";
+        return false;
+    }
+
 #ifdef USE_GPU
-    if (context.gpuContext != nullptr) {
-        std::ifstream file("rdf.cl");
-        std::string kernels((std::istreambuf_iterator<char>(file)),
-                            std::istreambuf_iterator<char>());
-        cl::Program::Sources sources;
-        sources.push_back({kernels.c_str(), kernels.length()});
-
-        context.gpuContext->program = cl::Program(context.gpuContext->context, sources);
-        if (context.gpuContext->program.build({context.gpuContext->device}) != CL_SUCCESS) {
-            std::cout << "Failed to build sources: "
-                << context.gpuContext->program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(context.gpuContext->device)
-                << "\n";
-            exit(EINVAL);
+    if (context.backend == grlTrainingBackendOpenCL) {
+        std::string error;
+        if (context.gpuContext == nullptr) {
+            std::cerr << "OpenCL backend needs the GPU context\n";
+            return false;
+        }
+        if (!OpenCLTrainingBackend::buildProgram(*context.gpuContext, error)) {
+            std::cerr << error << "\n";
+            return false;
         }
     }
 #endif
 
-    for (size_t i = 0; i < _trees.size(); i += context.nthreads) {
-        size_t size = std::min(_trees.size() - i, context.nthreads);
-        for (size_t n = 0; n < size; ++n)
-            _threads.push_back(std::thread(&RandomDecisionForest::trainTree, &_trees[i + n], &context));
+    // The training pixels address all of the images with the same geometry
+    for (auto it = context.depthImages.cbegin(); it != context.depthImages.cend(); ++it) {
+        const cv::Mat &first = context.depthImages.front();
+        if (it->type() != CV_32FC1 || it->size() != first.size() || it->step1() != first.step1()) {
+            std::cerr << "Depth images must be CV_32FC1 of the same size\n";
+            return false;
+        }
+    }
 
-        for (auto it = _threads.begin(); it != _threads.cend(); ++it)
-            it->join();
-        _threads.clear();
+    // Foreground of the images is the same for every tree, so find it once
+    std::vector<ForegroundSampler> samplers(context.classImages.size());
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(samplers.size()); ++i)
+        samplers[i].build(context.classImages[i]);
+
+    // Every tree is trained on the same number of pixels
+    size_t npixels = 0;
+    for (auto it = samplers.cbegin(); it != samplers.cend(); ++it)
+        npixels += std::min(context.pixelsPerImage, it->getForegroundSize());
+
+    TrainingMetrics defaultMetrics;
+    TrainingMetrics &metrics = context.metrics != nullptr ? *context.metrics : defaultMetrics;
+
+    TrainingMemoryBudget budget(context.memoryBudget);
+    size_t treePeak = TrainingMemoryBudget::estimateTreePeak(npixels);
+    if (context.memoryBudget != 0 && metrics.getVerbosity() >= grlTrainingVerbosityTrees) {
+        metrics.getLog() << "Memory budget " << toMegabytes(context.memoryBudget) << " MB, estimated "
+                  << toMegabytes(treePeak) << " MB per tree\n";
+        if (treePeak > context.memoryBudget)
+            std::cerr << "Tree does not fit in the memory budget, the trees will be trained one by one\n";
     }
+
+    // The threads take the next tree as soon as they are done with the
+    // previous one. The budget is acquired by the tree before it allocates
+    // anything, so the threads wait if there is not enough memory.
+    _peakMemory.resize(_trees.size());
+    std::unique_ptr<bool[]> results(new bool[_trees.size()]());
+    std::atomic<size_t> nextTree(first);
+    auto worker = [&]() {
+        for (size_t i = nextTree++; i < _trees.size(); i = nextTree++) {
+            budget.acquire(treePeak);
+            trainTree(&_trees[i], i, &context, &samplers, npixels, &metrics, &results[i], &_peakMemory[i]);
+            budget.release(treePeak);
+        }
+    };
+
+    size_t nthreads = std::min(_trees.size() - first, std::max<size_t>(context.nthreads, 1));
+    for (size_t n = 0; n < nthreads; ++n)
+        _threads.push_back(std::thread(worker));
+    for (auto it = _threads.begin(); it != _threads.end(); ++it)
+        it->join();
+    _threads.clear();
+
+    metrics.printDepthSummary();
+    if (metrics.getVerbosity() >= grlTrainingVerbosityTrees)
+        metrics.getLog() << "Peak process memory " << toMegabytes(getProcessPeakRSS()) << " MB\n";
+
+    return std::all_of(results.get() + first, results.get() + _trees.size(), [](bool result) { return result; });
 }
 
 void
-RandomDecisionForest::saveToFile(const std::string &fileName)
+RandomDecisionForest::saveToFile(const std::string &fileName, size_t firstTree)
 {
     std::ofstream file;
     file.open(fileName, std::ofstream::out);
 
-    int i = 0;
+    std::vector<std::streamoff> offsets;
+    size_t i = firstTree;
     for (auto it = _trees.begin(); it != _trees.end(); ++it, ++i) {
+        offsets.push_back(file.tellp());
         file << "T" << i << "\n";
         it->saveToFile(file);
     }
+
+    file.close();
+    saveIndex(fileName, firstTree, offsets);
+}
+
+static std::string
+getIndexFileName(const std::string &fileName)
+{
+    return fileName + ".idx";
+}
+
+// FNV-1a hash of the whole file, it is much cheaper than parsing the trees.
+// Returns false if the file cannot be read.
+static bool
+getFileChecksum(const std::string &fileName, std::streamoff &fileSize, uint64_t &checksum)
+{
+    std::ifstream file;
+    file.open(fileName, std::ifstream::in | std::ifstream::binary);
+    if (!file.is_open())
+        return false;
+
+    checksum = 14695981039346656037ULL;
+    fileSize = 0;
+    std::vector<char> buffer(1 << 16);
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize count = file.gcount();
+        for (std::streamsize i = 0; i < count; ++i) {
+            checksum ^= static_cast<unsigned char>(buffer[i]);
+            checksum *= 1099511628211ULL;
+        }
+        fileSize += count;
+    }
+
+    return file.eof();
+}
+
+void
+RandomDecisionForest::saveIndex(const std::string &fileName, size_t firstTree,
+                                const std::vector<std::streamoff> &offsets)
+{
+    std::streamoff fileSize;
+    uint64_t checksum;
+    if (!getFileChecksum(fileName, fileSize, checksum)) {
+        std::cerr << "Cannot save the index of " << fileName << "\n";
+        return;
+    }
+
+    std::ofstream file;
+    file.open(getIndexFileName(fileName), std::ofstream::out);
+    if (!file.is_open()) {
+        std::cerr << "Cannot save the index of " << fileName << "\n";
+        return;
+    }
+
+    // Header: first tree, number of trees, size and checksum of the forest file
+    file << "I" << firstTree << " " << offsets.size() << " " << fileSize << " " << checksum << "\n";
+    for (auto it = offsets.cbegin(); it != offsets.cend(); ++it)
+        file << *it << "\n";
 }
 
 bool
-RandomDecisionForest::loadFromFile(const std::string &fileName)
+RandomDecisionForest::loadIndex(const std::string &fileName, size_t &firstTree,
+                                std::vector<std::streamoff> &offsets)
+{
+    std::ifstream file;
+    file.open(getIndexFileName(fileName), std::ifstream::in);
+    if (!file.is_open())
+        return false;
+
+    char cmd;
+    size_t ntrees;
+    std::streamoff fileSize;
+    uint64_t checksum;
+    file >> cmd >> firstTree >> ntrees >> fileSize >> checksum;
+    if (!file || cmd != 'I')
+        return false;
+
+    // The forest was overwritten by something that did not update the index,
+    // even if the size of the file stayed the same
+    std::streamoff forestSize;
+    uint64_t forestChecksum;
+    if (!getFileChecksum(fileName, forestSize, forestChecksum) ||
+        forestSize != fileSize || forestChecksum != checksum)
+        return false;
+
+    offsets.resize(ntrees);
+    for (auto it = offsets.begin(); it != offsets.end(); ++it) {
+        file >> *it;
+        if (!file || *it < 0 || *it >= fileSize)
+            return false;
+    }
+
+    // The trees follow each other in the file
+    return std::is_sorted(offsets.cbegin(), offsets.cend()) &&
+           std::adjacent_find(offsets.cbegin(), offsets.cend()) == offsets.cend();
+}
+
+bool
+RandomDecisionForest::readTrees(const std::string &fileName, size_t &firstTree,
+                                std::vector<DecisionTree> &trees)
+{
+    std::vector<std::streamoff> offsets;
+    if (loadIndex(fileName, firstTree, offsets) && !offsets.empty()) {
+        if (readTreesParallel(fileName, firstTree, offsets, trees))
+            return true;
+        std::cerr << "Index of " << fileName << " does not match, reading it sequentially\n";
+    }
+
+    trees.clear();
+    return readTreesSequential(fileName, firstTree, trees);
+}
+
+bool
+RandomDecisionForest::readTreesParallel(const std::string &fileName, size_t firstTree,
+                                        const std::vector<std::streamoff> &offsets,
+                                        std::vector<DecisionTree> &trees)
+{
+    trees.resize(offsets.size());
+    std::atomic<bool> result(true);
+
+    // Each tree is parsed from its own stream positioned at its offset
+    ThreadPool workers(std::min<size_t>(offsets.size(), std::thread::hardware_concurrency()));
+    workers.parallelFor(offsets.size(), [&](size_t i) {
+        if (!result)
+            return;
+
+        std::ifstream file;
+        file.open(fileName, std::ifstream::in);
+        file.seekg(offsets[i]);
+
+        char cmd = 0;
+        size_t num = 0;
+        file >> cmd >> num;
+        if (!file || cmd != 'T' || num != firstTree + i) {
+            result = false;
+            return;
+        }
+
+        trees[i].readFromFile(file);
+    });
+
+    return result;
+}
+
+bool
+RandomDecisionForest::readTreesSequential(const std::string &fileName, size_t &firstTree,
+                                          std::vector<DecisionTree> &trees)
 {
     std::ifstream file;
     file.open(fileName, std::ifstream::in);
     if (!file.is_open())
         return false;
 
-    int treeNum = 0;
     while (!file.eof()) {
         // Check if the format is valid
         char cmd;
@@ -64,17 +338,61 @@ RandomDecisionForest::loadFromFile(const std::string &fileName)
         if (cmd != 'T')
             return file.eof();
 
-        int num;
+        size_t num;
         file >> num;
-        if (num != treeNum)
+        if (trees.empty())
+            firstTree = num;
+        else if (num != firstTree + trees.size())
             return file.eof();
 
-        _trees.push_back(DecisionTree());
-        _trees.back().readFromFile(file);
+        trees.push_back(DecisionTree());
+        trees.back().readFromFile(file);
+    }
 
-        ++treeNum;
+    return true;
+}
+
+bool
+RandomDecisionForest::loadFromFile(const std::string &fileName)
+{
+    size_t firstTree = 0;
+    std::vector<DecisionTree> trees;
+    if (!readTrees(fileName, firstTree, trees) || firstTree != 0)
+        return false;
+
+    std::move(trees.begin(), trees.end(), std::back_inserter(_trees));
+    return true;
+}
+
+bool
+RandomDecisionForest::mergeFromFiles(const std::vector<std::string> &fileNames)
+{
+    std::map<size_t, DecisionTree> merged;
+    for (auto itf = fileNames.cbegin(); itf != fileNames.cend(); ++itf) {
+        size_t firstTree = 0;
+        std::vector<DecisionTree> trees;
+        if (!readTrees(*itf, firstTree, trees)) {
+            std::cerr << "Cannot read partial forest " << *itf << "\n";
+            return false;
+        }
+
+        for (size_t i = 0; i < trees.size(); ++i) {
+            if (merged.count(firstTree + i) != 0)
+                std::cerr << "Tree " << firstTree + i << " replaced by the one from " << *itf << "\n";
+            merged[firstTree + i] = std::move(trees[i]);
+        }
     }
 
+    // The keys are sorted, so the last one must be the number of trees - 1
+    if (merged.empty() || merged.rbegin()->first != merged.size() - 1) {
+        std::cerr << "Partial forests do not contain all of the trees\n";
+        return false;
+    }
+
+    _trees.clear();
+    for (auto it = merged.begin(); it != merged.end(); ++it)
+        _trees.push_back(std::move(it->second));
+
     return true;
 }
 
@@ -82,7 +400,7 @@ using ProbabilitiesVector = std::vector<const std::vector<float> *>;
 
 void
 RandomDecisionForest::classifyImage(const cv::Mat &depthImage, cv::Mat &classImage,
-                                    ClassesWeights &weights, ClassesPoints &bestPoints)
+                                    ClassesWeights &weights, ClassesPoints &bestPoints) const
 {
     int width = depthImage.cols;
     int height = depthImage.rows;
@@ -94,7 +412,7 @@ RandomDecisionForest::classifyImage(const cv::Mat &depthImage, cv::Mat &classIma
         *it = cv::Mat::zeros(cv::Size(width, height), CV_32FC1);
 
     // Initialize array with list of the best points
-    for (auto it = bestPoints.begin(); it != bestPoints.end(); ++it, ++it)
+    for (auto it = bestPoints.begin(); it != bestPoints.end(); ++it)
         it->clear();
 
     auto itd = depthImage.begin<float>();
@@ -147,7 +465,7 @@ RandomDecisionForest::classifyImage(const cv::Mat &depthImage, cv::Mat &classIma
 std::pair<float, int8_t> RandomDecisionForest::getClassForPixel(
     const cv::Mat &depthImage,
     const Pixel &pixel,
-    std::vector<float> &probabilitiesSum)
+    std::vector<float> &probabilitiesSum) const
 {
     probabilitiesSum.clear();
 
@@ -180,108 +498,74 @@ std::pair<float, int8_t> RandomDecisionForest::getClassForPixel(
 }
 
 void
-RandomDecisionForest::trainTree(DecisionTree *tree, const ForestTrainContext *context)
+RandomDecisionForest::trainTree(DecisionTree *tree, size_t treeIndex, const ForestTrainContext *context,
+                                const std::vector<ForegroundSampler> *samplers, size_t npixels,
+                                TrainingMetrics *metrics, bool *result, size_t *peakMemory)
 {
-    static std::hash<std::thread::id> hasher;
-
-#ifdef USE_GPU
-    TreeTrainGPUContext treeGPU;
-    bool useGPU = false;
-    size_t pixelsNum = sizeof(Pixel) * context->pixelsPerImage * context->classImages.size();
-
-    cl_int err = 0;
-    if (context->gpuContext != nullptr) {
-        useGPU = true;
-        treeGPU.device = context->gpuContext->device;
-        treeGPU.context = context->gpuContext->context;
-        treeGPU.program = context->gpuContext->program;
-        treeGPU.queue = cl::CommandQueue(treeGPU.context, treeGPU.device);
-        treeGPU.maxImages = context->gpuContext->maxImages;
-
-        treeGPU.bufferAllPix = cl::Buffer(context->gpuContext->context, CL_MEM_READ_ONLY,
-                                          sizeof(Pixel)*pixelsNum, &err);
-        if (err != CL_SUCCESS) {
-            std::cout << "Pix buffer error" <<  std::endl;
-            exit(-1);
-        }
-        treeGPU.bufferSplit = cl::Buffer(context->gpuContext->context, CL_MEM_WRITE_ONLY,
-                                         sizeof(cl_char)*pixelsNum, &err);
-        if (err != CL_SUCCESS) {
-            std::cout << "Split buffer error" <<  std::endl;
-            exit(-1);
-        }
-        treeGPU.bufferPix = cl::Buffer(context->gpuContext->context, CL_MEM_WRITE_ONLY,
-                                       sizeof(Pixel)*pixelsNum, &err);
-        if (err != CL_SUCCESS) {
-            std::cout << "Pix2 buffer error" <<  std::endl;
-            exit(-1);
-        }
-        treeGPU.bufferPixCount = cl::Buffer(context->gpuContext->context, CL_MEM_WRITE_ONLY,
-                                            sizeof(cl_uint)*grlHandIndexNum, &err);
-        if (err != CL_SUCCESS) {
-            std::cout << "Pixcount buffer error" <<  std::endl;
-            exit(-1);
-        }
+    auto beginTime = std::chrono::steady_clock::now();
 
-        treeGPU.getFeatureTrain = cl::Kernel(treeGPU.program, "getFeatureTrain", &err);
-        treeGPU.getProbabilities = cl::Kernel(treeGPU.program, "getProbabilities", &err);
-    }
-#endif
     // Chose class pixels from each class image
-    std::vector<Pixel> *pixels = new std::vector<Pixel>;
-    pixels->reserve(context->pixelsPerImage * context->classImages.size());
+    TrainingPixels *pixels = new TrainingPixels;
+    pixels->reserve(npixels);
+    if (!context->depthImages.empty()) {
+        const cv::Mat &depthImage = context->depthImages.front();
+        pixels->setGeometry(depthImage.cols, depthImage.rows, depthImage.step1());
+    }
 
-    std::mt19937 gen(static_cast<unsigned int>(clock() + hasher(std::this_thread::get_id())));
-    printf("Generating...\n");
+    // The tree depends only on the seed and its index in the whole forest, so
+    // it is the same no matter which process or thread has trained it
+    RandomStream treeStream = RandomStream(context->seed).getSubstream(context->firstTree + treeIndex);
+    RandomStream samplingStream = treeStream.getSubstream(0);
+    std::vector<cv::Point> coords;
+    std::vector<uint32_t> scratch;
     uint32_t imgID = 0;
     for (auto itc = context->classImages.cbegin(), itd = context->depthImages.cbegin();
          itc != context->classImages.cend(); ++itc, ++itd, ++imgID) {
-        std::uniform_int_distribution<> coordXRand(0, itc->cols - 1);
-        std::uniform_int_distribution<> coordYRand(0, itc->rows - 1);
-        cv::Mat imgMask = cv::Mat::zeros(itc->rows, itc->cols, CV_8SC1);
-
-        size_t pixelsAcquired = 0;
-        int tryAgain = 0;
-        while (pixelsAcquired < context->pixelsPerImage) {
-            cv::Point coords(coordXRand(gen), coordYRand(gen));
-
-            // Check if this pixel was analyzed
-            int8_t &maskVal = imgMask.at<int8_t>(coords);
-            if (maskVal == 0) {
-                maskVal = 1;
-                tryAgain = 0;
-            } else {
-                // If we are finding masked pixel for 1000 times contiously, break the loop
-                if (++tryAgain == 1000)
-                    break;
-                continue;
-            }
+        coords.clear();
+        RandomStream imageStream = samplingStream.getSubstream(imgID);
+        (*samplers)[imgID].sample(context->pixelsPerImage, context->stratifiedSampling, imageStream,
+                                  coords, scratch);
+
+        const float *depthData = itd->ptr<float>();
+        for (auto it = coords.cbegin(); it != coords.cend(); ++it) {
+            pixels->push_back(static_cast<int16_t>(it->x), static_cast<int16_t>(it->y),
+                              itd->at<float>(*it), depthData, imgID, itc->at<int8_t>(*it));
+        }
+    }
 
-            // If the pixel is background, try again
-            int8_t index = itc->at<int8_t>(coords);
-            if (index == grlBackgroundIndex)
-                continue;
+    std::string error;
+    std::unique_ptr<TrainingBackend> backend = TrainingBackend::create(
+        context->backend, context->gpuContext, pixels->size(), error);
+    if (backend.get() == nullptr) {
+        std::cerr << "Cannot create training backend: " << error << "\n";
+        delete pixels;
+        *result = false;
+        return;
+    }
 
-            pixels->push_back(Pixel{
-#ifdef USE_GPU
-                Vector2<cl_short>{static_cast<cl_short>(coords.x), static_cast<cl_short>(coords.y)}, // Coords
-#else
-                Vector2<short>{static_cast<short>(coords.x), static_cast<short>(coords.y)}, // Coords
-#endif
-                itd->at<float>(coords), // Depth
-                imgID,
-                index});
-            ++pixelsAcquired;
-        }
+    TreeMetrics treeMetrics = {};
+    treeMetrics.tree = context->firstTree + treeIndex;
+    treeMetrics.backend = backend->getName();
+    treeMetrics.pixels = pixels->size();
+
+    TreeMemoryTracker memory;
+    std::vector<NodeMetrics> nodeMetrics;
+    *result = tree->train(pixels, context->depthImages, context->nodeTrainLimit, context->maxDepth,
+                          treeStream.getSubstream(1), *backend, memory, nodeMetrics);
+    *peakMemory = memory.getPeak();
+    if (!*result) {
+        std::cerr << "Training failed: " << backend->getError() << "\n";
+        return;
     }
 
-    printf("Tree training...\n");
-    tree->train(pixels, context->depthImages, context->nodeTrainLimit, context->maxDepth, gen,
-#ifdef USE_GPU
-                useGPU ? &treeGPU : nullptr);
-#else
-                nullptr);
-#endif
+    // Nodes can be turned into the leaves after they were trained, so the
+    // shape is taken from the final tree and only the work from the records
+    tree->getSize(treeMetrics.nodes, treeMetrics.leaves, treeMetrics.depth);
+    for (auto it = nodeMetrics.cbegin(); it != nodeMetrics.cend(); ++it)
+        treeMetrics.evaluations += static_cast<uint64_t>(it->candidates) * it->pixels;
+    treeMetrics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+    treeMetrics.peakMemory = memory.getPeak();
+    metrics->addTree(treeMetrics, nodeMetrics);
 }
 
-}
\ No newline at end of file
+}
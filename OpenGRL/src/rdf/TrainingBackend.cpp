@@ -0,0 +1,67 @@
+#include <grl/rdf/TrainingBackend.h>
+#include <grl/rdf/CPUTrainingBackend.h>
+#include <grl/rdf/OpenCLTrainingBackend.h>
+
+namespace grl {
+
+bool
+TrainingBackend::isAvailable(TrainingBackendType type)
+{
+    switch (type) {
+    case grlTrainingBackendAuto:
+    case grlTrainingBackendCPU:
+        return true;
+    case grlTrainingBackendAVX2:
+        return AVX2TrainingBackend::isSupported();
+    case grlTrainingBackendOpenCL:
+#ifdef USE_GPU
+        return true;
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+}
+
+std::unique_ptr<TrainingBackend>
+TrainingBackend::create(TrainingBackendType type, ForestTrainGPUContext *gpuContext,
+                        size_t maxPixels, std::string &error)
+{
+    if (type == grlTrainingBackendAuto)
+        type = AVX2TrainingBackend::isSupported() ? grlTrainingBackendAVX2 : grlTrainingBackendCPU;
+
+    switch (type) {
+    case grlTrainingBackendCPU:
+        return std::make_unique<CPUTrainingBackend>();
+    case grlTrainingBackendAVX2:
+        if (!AVX2TrainingBackend::isSupported()) {
+            error = "AVX2 is not supported by this CPU";
+            return nullptr;
+        }
+        return std::make_unique<AVX2TrainingBackend>();
+    case grlTrainingBackendOpenCL:
+    {
+#ifdef USE_GPU
+        if (gpuContext == nullptr) {
+            error = "OpenCL backend needs the GPU context";
+            return nullptr;
+        }
+        std::unique_ptr<OpenCLTrainingBackend> backend = std::make_unique<OpenCLTrainingBackend>();
+        if (!backend->init(*gpuContext, maxPixels)) {
+            error = backend->getError();
+            return nullptr;
+        }
+        return std::move(backend);
+#else
+        error = "OpenCL backend is not available, the library was built without USE_GPU";
+        return nullptr;
+#endif
+    }
+    default:
+        error = "Unknown training backend";
+        return nullptr;
+    }
+}
+
+}
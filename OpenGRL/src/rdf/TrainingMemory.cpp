@@ -0,0 +1,70 @@
+#include <grl/rdf/TrainingMemory.h>
+#include <grl/rdf/TrainingPixels.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace grl {
+
+void
+TrainingMemoryBudget::acquire(size_t bytes)
+{
+    if (_budget == 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _released.wait(lock, [this, bytes]() {
+        return _reserved == 0 || _reserved + bytes <= _budget;
+    });
+    _reserved += bytes;
+}
+
+void
+TrainingMemoryBudget::release(size_t bytes)
+{
+    if (_budget == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        assert(bytes <= _reserved);
+        _reserved -= bytes;
+    }
+    _released.notify_all();
+}
+
+size_t
+TrainingMemoryBudget::estimateTreePeak(size_t npixels)
+{
+    return npixels * (2 * TrainingPixels::bytesPerPixel + 2 * sizeof(uint8_t));
+}
+
+size_t
+getProcessPeakRSS()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    // Linux reports kilobytes
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+}
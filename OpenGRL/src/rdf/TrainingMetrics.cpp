@@ -0,0 +1,142 @@
+#include <grl/rdf/TrainingMetrics.h>
+
+#include <cmath>
+
+namespace grl {
+
+TrainingMetrics::TrainingMetrics(TrainingVerbosity verbosity, std::ostream &log)
+    : _verbosity(verbosity)
+    , _log(log)
+{
+}
+
+bool
+TrainingMetrics::openStream(const std::string &fileName, TrainingMetricsFormat format)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _stream.open(fileName, std::ofstream::out);
+    if (!_stream.is_open())
+        return false;
+
+    _format = format;
+    if (_format == grlTrainingMetricsCSV) {
+        _stream << "record,tree,node,depth,pixels,candidates,gain,seconds,"
+                << "evaluations_per_second,nodes,leaves,peak_memory\n";
+    }
+
+    return true;
+}
+
+void
+TrainingMetrics::addTree(const TreeMetrics &tree, const std::vector<NodeMetrics> &nodes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto it = nodes.cbegin(); it != nodes.cend(); ++it) {
+        if (static_cast<int>(_depths.size()) < it->depth)
+            _depths.resize(it->depth);
+        DepthTotals &totals = _depths[it->depth - 1];
+        ++totals.nodes;
+        totals.pixels += it->pixels;
+        totals.evaluations += static_cast<uint64_t>(it->candidates) * it->pixels;
+        totals.seconds += it->seconds;
+
+        if (_stream.is_open())
+            writeNode(tree.tree, *it);
+
+        if (_verbosity >= grlTrainingVerbosityNodes) {
+            _log << "Tree " << tree.tree << " node " << it->nodeID << " at depth " << it->depth
+                 << ": " << it->pixels << " pixels";
+            if (it->candidates == 0) {
+                _log << ", leaf\n";
+            } else {
+                _log << ", gain " << it->gain << ", " << it->seconds << " s, "
+                     << it->getEvaluationsPerSecond() << " evaluations/s\n";
+            }
+        }
+    }
+
+    if (_stream.is_open()) {
+        writeTree(tree);
+        _stream.flush();
+    }
+
+    if (_verbosity >= grlTrainingVerbosityTrees) {
+        _log << "Tree " << tree.tree << " trained using " << tree.backend << " in "
+             << tree.seconds << " s: " << tree.pixels << " pixels, " << tree.nodes << " nodes, "
+             << tree.leaves << " leaves, depth " << tree.depth << ", "
+             << (tree.seconds > 0.0 ? tree.evaluations / tree.seconds : 0.0) << " evaluations/s, "
+             << "peak memory " << static_cast<double>(tree.peakMemory) / (1 << 20) << " MB\n";
+    }
+}
+
+std::vector<TrainingMetrics::DepthTotals>
+TrainingMetrics::getDepthTotals() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _depths;
+}
+
+void
+TrainingMetrics::printDepthSummary()
+{
+    if (_verbosity < grlTrainingVerbosityTrees)
+        return;
+
+    std::vector<DepthTotals> depths = getDepthTotals();
+    double total = 0.0;
+    for (auto it = depths.cbegin(); it != depths.cend(); ++it)
+        total += it->seconds;
+
+    _log << "Depth  Nodes  Pixels  Seconds  Share\n";
+    for (size_t i = 0; i < depths.size(); ++i) {
+        _log << i + 1 << "  " << depths[i].nodes << "  " << depths[i].pixels << "  "
+             << depths[i].seconds << "  "
+             << (total > 0.0 ? 100.0 * depths[i].seconds / total : 0.0) << "%\n";
+    }
+}
+
+void
+TrainingMetrics::writeNode(size_t tree, const NodeMetrics &node)
+{
+    bool leaf = node.candidates == 0 || std::isnan(node.gain);
+    if (_format == grlTrainingMetricsCSV) {
+        _stream << "node," << tree << ',' << node.nodeID << ',' << node.depth << ','
+                << node.pixels << ',' << node.candidates << ',';
+        if (!leaf)
+            _stream << node.gain;
+        _stream << ',' << node.seconds << ',' << node.getEvaluationsPerSecond() << ",,,\n";
+    } else {
+        _stream << "{\"record\":\"node\",\"tree\":" << tree << ",\"node\":" << node.nodeID
+                << ",\"depth\":" << node.depth << ",\"pixels\":" << node.pixels
+                << ",\"candidates\":" << node.candidates << ",\"gain\":";
+        if (leaf)
+            _stream << "null";
+        else
+            _stream << node.gain;
+        _stream << ",\"seconds\":" << node.seconds
+                << ",\"evaluations_per_second\":" << node.getEvaluationsPerSecond() << "}\n";
+    }
+}
+
+void
+TrainingMetrics::writeTree(const TreeMetrics &tree)
+{
+    double evaluationsPerSecond = tree.seconds > 0.0 ? tree.evaluations / tree.seconds : 0.0;
+    if (_format == grlTrainingMetricsCSV) {
+        _stream << "tree," << tree.tree << ",," << tree.depth << ',' << tree.pixels << ",,,"
+                << tree.seconds << ',' << evaluationsPerSecond << ',' << tree.nodes << ','
+                << tree.leaves << ',' << tree.peakMemory << '\n';
+    } else {
+        _stream << "{\"record\":\"tree\",\"tree\":" << tree.tree
+                << ",\"backend\":\"" << tree.backend << "\",\"pixels\":" << tree.pixels
+                << ",\"nodes\":" << tree.nodes << ",\"leaves\":" << tree.leaves
+                << ",\"depth\":" << tree.depth << ",\"evaluations\":" << tree.evaluations
+                << ",\"seconds\":" << tree.seconds
+                << ",\"evaluations_per_second\":" << evaluationsPerSecond
+                << ",\"peak_memory\":" << tree.peakMemory << "}\n";
+    }
+}
+
+}
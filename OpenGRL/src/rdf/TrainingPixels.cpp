@@ -0,0 +1,55 @@
+#include <grl/rdf/TrainingPixels.h>
+
+namespace grl {
+
+constexpr size_t TrainingPixels::bytesPerPixel;
+
+void
+TrainingPixels::reserve(size_t n)
+{
+    _x.reserve(n);
+    _y.reserve(n);
+    _invDepth.reserve(n);
+    _images.reserve(n);
+    _imageIDs.reserve(n);
+    _classes.reserve(n);
+}
+
+void
+TrainingPixels::clear()
+{
+    _x.clear();
+    _y.clear();
+    _invDepth.clear();
+    _images.clear();
+    _imageIDs.clear();
+    _classes.clear();
+}
+
+void
+TrainingPixels::partition(const std::vector<uint8_t> &directions, uint8_t leftDirection,
+                          TrainingPixels &left, TrainingPixels &right) const
+{
+    assert(directions.size() == size());
+
+    left.setGeometry(*this);
+    right.setGeometry(*this);
+
+    size_t leftSize = 0;
+    for (auto it = directions.cbegin(); it != directions.cend(); ++it)
+        leftSize += (*it == leftDirection);
+    left.reserve(leftSize);
+    right.reserve(size() - leftSize);
+
+    for (size_t i = 0; i < size(); ++i) {
+        TrainingPixels &dst = directions[i] == leftDirection ? left : right;
+        dst._x.push_back(_x[i]);
+        dst._y.push_back(_y[i]);
+        dst._invDepth.push_back(_invDepth[i]);
+        dst._images.push_back(_images[i]);
+        dst._imageIDs.push_back(_imageIDs[i]);
+        dst._classes.push_back(_classes[i]);
+    }
+}
+
+}
@@ -9,9 +9,16 @@ GaussianKernel::GaussianKernel(float bandwidth, size_t size)
     _n = size;
     _mask.reserve(size);
 
-    int mid = static_cast<int>(_n / 2);
-    for (int y = 0; y < _n; ++y) {
-        for (int x = 0; x < _n; ++x) {
+    int n = static_cast<int>(_n);
+    int mid = n / 2;
+    _profile.reserve(size);
+    for (int x = 0; x < n; ++x) {
+        float val = static_cast<float>(x - mid) / bandwidth;
+        _profile.push_back(exp(-val*val));
+    }
+
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
             Vec2i coords{ (x-mid), (y-mid) };
             float val = coords.length() / bandwidth;
             _mask.push_back(exp(-val*val));
@@ -24,6 +24,7 @@ MainWindow::MainWindow(QWidget *parent)
 
     grl::SkeletonExtractorConfig skeletonExtractorConfig;
     skeletonExtractorConfig.depthTolerance = 20;
+    skeletonExtractorConfig.parallelHands = true;
 
 	SAFE_QT_NEW(_extractor, grl::SkeletonExtractor);
 	if (!_extractor->init(skeletonExtractorConfig)) {
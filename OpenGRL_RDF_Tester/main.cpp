@@ -1,6 +1,7 @@
 #include "ImageWindow.h"
 #include <grl/gesture/RDFHandSkeletonExtractor.h>
 #include <grl/gesture/GestureClassificator.h>
+#include <grl/rdf/ForestEvaluator.h>
 #include <grl/rdf/RDFUtils.h>
 #include <grl/camera/KinectCamera.h>
 #include <grl/track/TrackClassificator.h>
@@ -8,72 +9,71 @@
 namespace grl {
 
 // Better do not use this one if one does not have the images from blender
-void pixelClassStats()
+struct PixelStatsSettings
+{
+    std::string forest = "../resources/rdf.txt";
+    std::string classPrefix = "../../generated-train-small/hand_classes_";
+    std::string depthPrefix = "../../generated-train-small/hand_depth_";
+    // Images of each pose are numbered from first + pose*poseStride and
+    // every step-th of the next poseImages images is used.
+    size_t first = 1;
+    size_t poses = 12;
+    size_t poseStride = 2000;
+    size_t poseImages = 200;
+    size_t step = 2;
+    // 0 - use all hardware threads
+    size_t nthreads = 0;
+};
+
+void pixelClassStats(const PixelStatsSettings &settings)
 {
     grl::RandomDecisionForest forest;
-    if (!forest.loadFromFile("../resources/rdf.txt")) {
+    if (!forest.loadFromFile(settings.forest)) {
         std::cout << "Invalid forest" << std::endl;
         exit(1);
     }
 
-    std::map<size_t, std::pair<size_t, size_t> > poseStats;
-    size_t npose = 0;
-    for (size_t i = 1; i < 24000; i+= 2000, ++npose) {
-        std::vector<cv::Mat> classImages;
-        std::vector<cv::Mat> depthImages;
+    std::vector<cv::Mat> classImages;
+    std::vector<cv::Mat> depthImages;
+    std::vector<size_t> poses;
+    for (size_t npose = 0; npose < settings.poses; ++npose) {
+        size_t start = settings.first + npose * settings.poseStride;
 
         std::cout << "Loading images for pose "
                   << npose
                   << ", and images in range: "
-                  << i
+                  << start
                   << ".."
-                  << i+200
+                  << start + settings.poseImages
                   << std::endl;
 
-        RDFTools::loadDepthImagesWithClasses(
-            i, i+200, 2, 7,
-            "../../generated-train-small/hand_classes_", // png
-            "../../generated-train-small/hand_depth_", // png
-            classImages, depthImages
+        // The images are aligned to the size of their own batch, so each pose
+        // is loaded into fresh vectors and only then added to the others
+        std::vector<cv::Mat> poseClassImages;
+        std::vector<cv::Mat> poseDepthImages;
+        RDFTools::loadDepthImagesWithClassesParallel(
+            start, start + settings.poseImages, settings.step, 7,
+            settings.classPrefix, // png
+            settings.depthPrefix, // png
+            poseClassImages, poseDepthImages, settings.nthreads
         );
-
-        std::cout << "Image loading done, checking score...\n";
-
-        size_t totalPixels = 0;
-        size_t matched = 0;
-        for (size_t n = 0; n < 100; ++n) {
-            cv::Mat classImage = classImages[n];
-            cv::Mat depthImage = depthImages[n];
-
-            cv::Mat foundClasses;
-            ClassesWeights weights; ClassesPoints points;
-            forest.classifyImage(depthImage, foundClasses, weights, points);
-
-            for (auto foundPixel = foundClasses.begin<int8_t>(), referencePixel = classImage.begin<int8_t>();
-                 foundPixel != foundClasses.end<int8_t>();
-                 ++foundPixel, ++referencePixel)
-            {
-                if (*foundPixel == grlBackgroundIndex)
-                    continue;
-                ++totalPixels;
-                if (*foundPixel == *referencePixel)
-                    ++matched;
-            }
-        }
-        poseStats[npose] = std::make_pair(matched, totalPixels);
+        classImages.insert(classImages.end(),
+                           std::make_move_iterator(poseClassImages.begin()),
+                           std::make_move_iterator(poseClassImages.end()));
+        depthImages.insert(depthImages.end(),
+                           std::make_move_iterator(poseDepthImages.begin()),
+                           std::make_move_iterator(poseDepthImages.end()));
+        poses.resize(depthImages.size(), npose);
     }
 
-    for (auto it = poseStats.begin(); it != poseStats.end(); ++it) {
-        std::cout << "Stats for pose " << it->first << ":" << std::endl;
-        std::cout << "\tmatched "
-                  << it->second.first
-                  << "/"
-                  << it->second.second
-                  << " "
-                  << static_cast<double>(it->second.first) / it->second.second * 100.0f
-                  << "%"
-                  << std::endl;
+    std::cout << "Image loading done, checking score...\n";
+
+    ForestEvaluator evaluator(forest);
+    if (!evaluator.evaluate(classImages, depthImages, poses, settings.nthreads)) {
+        std::cout << "Evaluation failed" << std::endl;
+        exit(1);
     }
+    evaluator.print(std::cout);
 }
 
 static const std::string baseFolderLearn("tracks-learn");
@@ -386,8 +386,19 @@ int main(int argc, char **argv)
     // Unless the ImageWindow is used, this can be commented
     //QApplication app(argc, argv);
 
+    // Usage: OpenGRL_RDF_Tester [forest] [class prefix] [depth prefix] [poses]
+    grl::PixelStatsSettings pixelSettings;
+    if (argc > 1)
+        pixelSettings.forest = argv[1];
+    if (argc > 2)
+        pixelSettings.classPrefix = argv[2];
+    if (argc > 3)
+        pixelSettings.depthPrefix = argv[3];
+    if (argc > 4)
+        pixelSettings.poses = std::strtoul(argv[4], nullptr, 10);
+
     std::cout << "Checking pixel classification" << std::endl;
-    grl::pixelClassStats();
+    grl::pixelClassStats(pixelSettings);
     std::cout << "Checking track classification" << std::endl;
     grl::testTrackClassification();
     std::cout << "Checking hand gesture classification" << std::endl;
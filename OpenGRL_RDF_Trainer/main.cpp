@@ -1,28 +1,170 @@
 #include <grl/rdf/RandomDecisionForest.h>
 
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
-#ifdef USE_GPU
-constexpr bool gpuTraining = true;
-#else
-constexpr bool gpuTraining = false;
-#endif
+// Usage:
+//   rdf_trainer [auto|cpu|avx2|opencl]
+//     Train the whole forest and save it to forest-small.txt.
+//   rdf_trainer shard <backend> <seed> <first tree> <trees> <output>
+//     Train the trees from <first tree> to <first tree> + <trees> - 1 of the
+//     forest and save them as the partial forest. The same seed must be used
+//     by all of the shards.
+//   rdf_trainer merge <output> <partial forest>...
+//     Merge the partial forests into one forest. If the tree is in more
+//     partial forests, the one from the last of them is used, so the single
+//     tree can be retrained and merged with the rest.
+//   rdf_trainer append <backend> <seed> <trees> <input> <output>
+//     Train more trees and append them to the input forest.
+//   rdf_trainer refit <input> <output> <dataset> [<images>]
+//     Refit the leaves of the input forest to the images from the <dataset>
+//     directory, every second of the first <images> ones (24000 by default).
+static void
+printUsage()
+{
+    std::cout << "Usage:\n"
+              << "  rdf_trainer [auto|cpu|avx2|opencl]\n"
+              << "  rdf_trainer shard <backend> <seed> <first tree> <trees> <output>\n"
+              << "  rdf_trainer merge <output> <partial forest>...\n"
+              << "  rdf_trainer append <backend> <seed> <trees> <input> <output>\n"
+              << "  rdf_trainer refit <input> <output> <dataset> [<images>]\n";
+}
 
-int main()
+static grl::TrainingBackendType
+parseBackend(const char *name)
 {
-    grl::ForestTrainGPUContext gpuContext;
+    if (name == nullptr || strcmp(name, "auto") == 0)
+        return grl::grlTrainingBackendAuto;
+    if (strcmp(name, "cpu") == 0)
+        return grl::grlTrainingBackendCPU;
+    if (strcmp(name, "avx2") == 0)
+        return grl::grlTrainingBackendAVX2;
+    if (strcmp(name, "opencl") == 0)
+        return grl::grlTrainingBackendOpenCL;
+
+    std::cout << "Unknown backend " << name << ", using auto\n";
+    return grl::grlTrainingBackendAuto;
+}
+
+static bool
+parseNumber(const char *str, unsigned long &number)
+{
+    char *end;
+    errno = 0;
+    number = strtoul(str, &end, 10);
+    return errno == 0 && end != str && *end == '\0';
+}
+
+static int
+mergeForests(int argc, char *argv[])
+{
+    if (argc < 4) {
+        printUsage();
+        return EINVAL;
+    }
+
+    std::vector<std::string> partialForests(argv + 3, argv + argc);
+    grl::RandomDecisionForest forest;
+    if (!forest.mergeFromFiles(partialForests))
+        return 1;
+
+    std::cout << "Merged " << partialForests.size() << " partial forests\n";
+    forest.saveToFile(argv[2]);
+    return 0;
+}
+
+// Images generated by OpenGRL_GestureGenerator used for the training
+static const char *defaultDataset = "../OpenGRL_GestureGenerator/generated-train-small";
+static const unsigned long defaultImages = 24000;
+
+static void
+loadTrainingImages(const std::string &dataset, unsigned long images,
+                   std::vector<cv::Mat> &classImages, std::vector<cv::Mat> &depthImages)
+{
+    printf("Loading RDF from %s...\n", dataset.c_str());
+    grl::RDFTools::loadDepthImagesWithClassesParallel(
+        0, images, 2, 7,
+        dataset + "/hand_classes_", // png
+        dataset + "/hand_depth_", // exr
+        classImages, depthImages);
+}
+
+static int
+refitForest(int argc, char *argv[])
+{
+    unsigned long images = defaultImages;
+    if ((argc != 5 && argc != 6) || (argc == 6 && (!parseNumber(argv[5], images) || images == 0))) {
+        printUsage();
+        return EINVAL;
+    }
+
+    grl::RandomDecisionForest forest;
+    if (!forest.loadFromFile(argv[2])) {
+        std::cout << "Cannot load forest " << argv[2] << "\n";
+        return 1;
+    }
+
+    std::vector<cv::Mat> classImages, depthImages;
+    loadTrainingImages(argv[4], images, classImages, depthImages);
+    if (classImages.empty()) {
+        std::cout << "No images in " << argv[4] << "\n";
+        return 1;
+    }
+
+    printf("Refitting leaves...\n");
+    forest.refitLeaves(classImages, depthImages);
+    forest.saveToFile(argv[3]);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 2 && strcmp(argv[1], "merge") == 0)
+        return mergeForests(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "refit") == 0)
+        return refitForest(argc, argv);
+
+    // Whole forest by default
+    bool shard = argc >= 2 && strcmp(argv[1], "shard") == 0;
+    bool append = argc >= 2 && strcmp(argv[1], "append") == 0;
+    unsigned long seed = 0;
+    unsigned long firstTree = 0;
+    unsigned long ntrees = 5;
+    std::string input;
+    std::string output = "forest-small.txt";
+    if (shard) {
+        if (argc != 7 || !parseNumber(argv[3], seed) || !parseNumber(argv[4], firstTree) ||
+            !parseNumber(argv[5], ntrees) || ntrees == 0) {
+            printUsage();
+            return EINVAL;
+        }
+        output = argv[6];
+    } else if (append) {
+        if (argc != 7 || !parseNumber(argv[3], seed) || !parseNumber(argv[4], ntrees) || ntrees == 0) {
+            printUsage();
+            return EINVAL;
+        }
+        input = argv[5];
+        output = argv[6];
+    }
+
+    grl::TrainingBackendType backend = parseBackend((shard || append) ? argv[2] : (argc >= 2 ? argv[1] : nullptr));
+    grl::ForestTrainGPUContext *gpuContextPtr = nullptr;
 #ifdef USE_GPU
-    if (gpuTraining) {
+    grl::ForestTrainGPUContext gpuContext;
+    if (backend == grl::grlTrainingBackendOpenCL) {
         cl_int err = CL_SUCCESS;
 
         std::vector<cl::Platform> platforms;
         cl::Platform::get(&platforms);
         if (platforms.empty()) {
             std::cout << "No platforms found!\n";
-            exit(ENODEV);
+            return ENODEV;
         }
         cl::Platform default_platform = platforms[1];
         std::cout << "Using platform: " << default_platform.getInfo<CL_PLATFORM_NAME>() << "\n";
@@ -34,7 +176,7 @@ int main()
         std::vector<cl::Device> devices = clGPUContext.getInfo<CL_CONTEXT_DEVICES>(&err);
         if (devices.empty()) {
             std::cout << "No devices found!\n";
-            exit(ENODEV);
+            return ENODEV;
         }
         gpuContext.device = devices[0];
         std::cout << "Using device: " << gpuContext.device.getInfo<CL_DEVICE_NAME>(&err) << "\n";
@@ -42,30 +184,49 @@ int main()
         gpuContext.context = cl::Context({gpuContext.device});
         // Experimental
         gpuContext.maxImages = 5;
+        gpuContextPtr = &gpuContext;
     }
 #endif
 
-    grl::RandomDecisionForest forest(5);
-    grl::ForestTrainContext ctx = {
-        gpuTraining ? &gpuContext : nullptr,
-        5,
-        2500,
-        4000, // n tries
-        20
-    };
-
-    printf("Loading RDF...\n");
-    grl::loadDepthImagesWithClasses(
-        0, 24000, 2, 7,
-        "../OpenGRL_GestureGenerator/generated-train-small/hand_classes_", // png
-        "../OpenGRL_GestureGenerator/generated-train-small/hand_depth_", // exr
-        ctx.classImages, ctx.depthImages);
+    grl::RandomDecisionForest forest(append ? 0 : ntrees);
+    if (append && !forest.loadFromFile(input)) {
+        std::cout << "Cannot load forest " << input << "\n";
+        return 1;
+    }
+
+    grl::ForestTrainContext ctx;
+    ctx.gpuContext = gpuContextPtr;
+    ctx.nthreads = 5;
+    ctx.pixelsPerImage = 2500;
+    ctx.nodeTrainLimit = 4000; // n tries
+    ctx.maxDepth = 20;
+    // Half of the 32 GB machine for the training pixels
+    ctx.memoryBudget = static_cast<size_t>(16) << 30;
+    ctx.backend = backend;
+    ctx.seed = static_cast<uint32_t>(seed);
+    ctx.firstTree = firstTree;
+
+    // Records of all nodes go to the file next to the forest
+    grl::TrainingMetrics metrics(grl::grlTrainingVerbosityTrees);
+    if (!metrics.openStream(output + ".metrics.csv", grl::grlTrainingMetricsCSV))
+        std::cout << "Cannot open the metrics file, printing the trees only\n";
+    ctx.metrics = &metrics;
+
+    loadTrainingImages(defaultDataset, defaultImages, ctx.classImages, ctx.depthImages);
 
 #ifdef _OPENMP
     std::cout << "Threads: " << omp_get_max_threads() << std::endl;
 #endif
 
-    printf("Training RDF...\n");
-    forest.train(ctx);
-    forest.saveToFile("forest-small.txt");
+    if (append) {
+        size_t first = forest.getSize();
+        printf("Appending trees %zu-%zu with seed %lu...\n", first, first + ntrees - 1, seed);
+        if (!forest.appendTrees(ntrees, ctx))
+            return 1;
+    } else {
+        printf("Training trees %lu-%lu with seed %lu...\n", firstTree, firstTree + ntrees - 1, seed);
+        if (!forest.train(ctx))
+            return 1;
+    }
+    forest.saveToFile(output, firstTree);
 }
@@ -1,11 +1,73 @@
 #include "stdafx.h"
 #include "CppUnitTest.h"
 
+#include <grl/gesture/ConnectedComponents.h>
+#include <grl/gesture/RDFHandSkeletonExtractor.h>
 #include <grl/gesture/SkeletonExtractor.h>
 
+#include <cstdio>
+#include <cstdlib>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 namespace OpenGRL_UnitTests_GestureExtractor {
+TEST_CLASS(DepthObjectTester)
+{
+public:
+    TEST_METHOD(spans)
+    {
+        grl::DepthObject object;
+
+        // Voxels next to each other are merged into one run
+        grl::Voxel voxel;
+        voxel.coords = grl::Vec3i(3, 2, 500);
+        object.putVoxel(voxel);
+        voxel.coords = grl::Vec3i(4, 2, 700);
+        object.putVoxel(voxel);
+        const uint16_t depths[] = { 600, 0, 800 };
+        object.putSpan(2, 4, depths, 3);
+
+        Assert::AreEqual(static_cast<size_t>(5), object.getSize());
+        Assert::AreEqual(static_cast<size_t>(2), object.getSpansNumber());
+        grl::DepthSpan span = object.getSpan(0);
+        Assert::AreEqual(3, span.x);
+        Assert::AreEqual(2, span.y);
+        Assert::AreEqual(2, span.length);
+        Assert::AreEqual(700, static_cast<int>(span.depths[1]));
+
+        Assert::IsTrue(cv::Rect(2, 2, 3, 3) == object.getBoundingBox());
+        Assert::AreEqual(0, object.getMinDepthValue());
+        Assert::AreEqual(800, object.getMaxDepthValue());
+
+        const cv::Mat &depth = object.getDepthImageOfObject();
+        Assert::AreEqual(500, static_cast<int>(depth.at<uint16_t>(0, 1)));
+        Assert::AreEqual(0, static_cast<int>(depth.at<uint16_t>(1, 1)));
+        Assert::AreEqual(800, static_cast<int>(depth.at<uint16_t>(2, 2)));
+
+        // Voxel with depth 0 is still the part of the object
+        cv::Mat mask;
+        object.getMask(mask);
+        Assert::AreEqual(255, static_cast<int>(mask.at<uint8_t>(2, 1)));
+        Assert::AreEqual(0, static_cast<int>(mask.at<uint8_t>(0, 0)));
+        Assert::AreEqual(static_cast<int>(object.getSize()), cv::countNonZero(mask));
+
+        cv::Mat meters;
+        object.getDepthInMeters(meters);
+        Assert::AreEqual(0.7f, meters.at<float>(0, 2));
+        Assert::AreEqual(0.6f, meters.at<float>(2, 0));
+        Assert::AreEqual(0.0f, meters.at<float>(1, 0));
+
+        // The buffer is reused, the pixels written before must be cleared
+        std::vector<float> buffer(9, 1.0f);
+        const float *storage = buffer.data();
+        object.getDepthInMeters(buffer, meters);
+        Assert::IsTrue(storage == buffer.data());
+        Assert::IsTrue(storage == meters.ptr<float>());
+        Assert::AreEqual(0.7f, meters.at<float>(0, 2));
+        Assert::AreEqual(0.0f, meters.at<float>(1, 0));
+    }
+};
+
 TEST_CLASS(VoxelArray2DTester)
 {
 private:
@@ -50,121 +112,121 @@ public:
         int lastY = height-1;
         // 3 neighbours in each conerner
         {
-            Assert::AreEqual(3, va(0, 0).neighboursNumber);
-            Assert::AreEqual(3, va(lastX, 0).neighboursNumber);
-            Assert::AreEqual(3, va(0, lastY).neighboursNumber);
-            Assert::AreEqual(3, va(lastX, lastY).neighboursNumber);
+            Assert::AreEqual(3, va.getNeighboursNumber(0, 0));
+            Assert::AreEqual(3, va.getNeighboursNumber(lastX, 0));
+            Assert::AreEqual(3, va.getNeighboursNumber(0, lastY));
+            Assert::AreEqual(3, va.getNeighboursNumber(lastX, lastY));
         }
 
         // 5 neighbours on each wall
         {
-            Assert::AreEqual(5, va(0, height/2).neighboursNumber);
-            Assert::AreEqual(5, va(lastX, height/2).neighboursNumber);
-            Assert::AreEqual(5, va(width/2, 0).neighboursNumber);
-            Assert::AreEqual(5, va(width/2, lastY).neighboursNumber);
+            Assert::AreEqual(5, va.getNeighboursNumber(0, height/2));
+            Assert::AreEqual(5, va.getNeighboursNumber(lastX, height/2));
+            Assert::AreEqual(5, va.getNeighboursNumber(width/2, 0));
+            Assert::AreEqual(5, va.getNeighboursNumber(width/2, lastY));
         }
 
         // Image with depth tolerance set to 50 should have neighbours with 100
         // depth and 150 depth.
         {
-            Assert::AreEqual(0, vaImageTolerant(0, 0).neighboursNumber);
-            Assert::AreEqual(8, vaImageTolerant(2, 2).neighboursNumber);
+            Assert::AreEqual(0, vaImageTolerant.getNeighboursNumber(0, 0));
+            Assert::AreEqual(8, vaImageTolerant.getNeighboursNumber(2, 2));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(100, vaImageTolerant(2, 2).neighbours[0]->coords.z);
-                Assert::AreEqual(150, vaImageTolerant(2, 2).neighbours[6]->coords.z);
-                Assert::AreEqual(100, vaImageTolerant(2, 2).neighbours[7]->coords.z);
+                Assert::AreEqual(100, vaImageTolerant.getNeighbour(2, 2, 0).coords.z);
+                Assert::AreEqual(150, vaImageTolerant.getNeighbour(2, 2, 6).coords.z);
+                Assert::AreEqual(100, vaImageTolerant.getNeighbour(2, 2, 7).coords.z);
             }
 
-            Assert::AreEqual(8, vaImageTolerant(2, 3).neighboursNumber);
+            Assert::AreEqual(8, vaImageTolerant.getNeighboursNumber(2, 3));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(100, vaImageTolerant(2, 3).neighbours[0]->coords.z);
-                Assert::AreEqual(150, vaImageTolerant(2, 3).neighbours[3]->coords.z);
-                Assert::AreEqual(150, vaImageTolerant(2, 3).neighbours[6]->coords.z);
+                Assert::AreEqual(100, vaImageTolerant.getNeighbour(2, 3, 0).coords.z);
+                Assert::AreEqual(150, vaImageTolerant.getNeighbour(2, 3, 3).coords.z);
+                Assert::AreEqual(150, vaImageTolerant.getNeighbour(2, 3, 6).coords.z);
             }
 
-            Assert::AreEqual(5, vaImageTolerant(2, 5).neighboursNumber);
+            Assert::AreEqual(5, vaImageTolerant.getNeighboursNumber(2, 5));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(150, vaImageTolerant(2, 5).neighbours[0]->coords.z);
-                Assert::AreEqual(100, vaImageTolerant(2, 5).neighbours[2]->coords.z);
-                Assert::AreEqual(150, vaImageTolerant(2, 5).neighbours[3]->coords.z);
-                Assert::AreEqual(100, vaImageTolerant(2, 5).neighbours[4]->coords.z);
+                Assert::AreEqual(150, vaImageTolerant.getNeighbour(2, 5, 0).coords.z);
+                Assert::AreEqual(100, vaImageTolerant.getNeighbour(2, 5, 2).coords.z);
+                Assert::AreEqual(150, vaImageTolerant.getNeighbour(2, 5, 3).coords.z);
+                Assert::AreEqual(100, vaImageTolerant.getNeighbour(2, 5, 4).coords.z);
             }
 
-            Assert::AreEqual(3, vaImageTolerant(5, 5).neighboursNumber);
+            Assert::AreEqual(3, vaImageTolerant.getNeighboursNumber(5, 5));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(100, vaImageTolerant(5, 5).neighbours[0]->coords.z);
-                Assert::AreEqual(100, vaImageTolerant(5, 5).neighbours[1]->coords.z);
-                Assert::AreEqual(100, vaImageTolerant(5, 5).neighbours[2]->coords.z);
+                Assert::AreEqual(100, vaImageTolerant.getNeighbour(5, 5, 0).coords.z);
+                Assert::AreEqual(100, vaImageTolerant.getNeighbour(5, 5, 1).coords.z);
+                Assert::AreEqual(100, vaImageTolerant.getNeighbour(5, 5, 2).coords.z);
             }
 
-            Assert::AreEqual(5, vaImageTolerant(6, 5).neighboursNumber);
+            Assert::AreEqual(5, vaImageTolerant.getNeighboursNumber(6, 5));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(250, vaImageTolerant(6, 5).neighbours[0]->coords.z);
-                Assert::AreEqual(250, vaImageTolerant(6, 5).neighbours[3]->coords.z);
-                Assert::AreEqual(250, vaImageTolerant(6, 5).neighbours[4]->coords.z);
+                Assert::AreEqual(250, vaImageTolerant.getNeighbour(6, 5, 0).coords.z);
+                Assert::AreEqual(250, vaImageTolerant.getNeighbour(6, 5, 3).coords.z);
+                Assert::AreEqual(250, vaImageTolerant.getNeighbour(6, 5, 4).coords.z);
             }
 
-            Assert::AreEqual(2, vaImageTolerant(5, 6).neighboursNumber);
+            Assert::AreEqual(2, vaImageTolerant.getNeighboursNumber(5, 6));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(0, vaImageTolerant(5, 6).neighbours[0]->coords.z);
-                Assert::AreEqual(0, vaImageTolerant(5, 6).neighbours[1]->coords.z);
+                Assert::AreEqual(0, vaImageTolerant.getNeighbour(5, 6, 0).coords.z);
+                Assert::AreEqual(0, vaImageTolerant.getNeighbour(5, 6, 1).coords.z);
             }
         }
 
         // No tolerance should have only neighbours which have the same depth
         {
-            Assert::AreEqual(0, vaImageUntolerant(0, 0).neighboursNumber);
-            Assert::AreEqual(4, vaImageUntolerant(2, 2).neighboursNumber);
+            Assert::AreEqual(0, vaImageUntolerant.getNeighboursNumber(0, 0));
+            Assert::AreEqual(4, vaImageUntolerant.getNeighboursNumber(2, 2));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(100, vaImageUntolerant(2, 2).neighbours[0]->coords.z);
-                Assert::AreEqual(100, vaImageUntolerant(2, 2).neighbours[2]->coords.z);
-                Assert::AreEqual(100, vaImageUntolerant(2, 2).neighbours[3]->coords.z);
+                Assert::AreEqual(100, vaImageUntolerant.getNeighbour(2, 2, 0).coords.z);
+                Assert::AreEqual(100, vaImageUntolerant.getNeighbour(2, 2, 2).coords.z);
+                Assert::AreEqual(100, vaImageUntolerant.getNeighbour(2, 2, 3).coords.z);
             }
 
-            Assert::AreEqual(4, vaImageUntolerant(2, 3).neighboursNumber);
+            Assert::AreEqual(4, vaImageUntolerant.getNeighboursNumber(2, 3));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(150, vaImageUntolerant(2, 3).neighbours[0]->coords.z);
-                Assert::AreEqual(150, vaImageUntolerant(2, 3).neighbours[2]->coords.z);
-                Assert::AreEqual(150, vaImageUntolerant(2, 3).neighbours[3]->coords.z);
+                Assert::AreEqual(150, vaImageUntolerant.getNeighbour(2, 3, 0).coords.z);
+                Assert::AreEqual(150, vaImageUntolerant.getNeighbour(2, 3, 2).coords.z);
+                Assert::AreEqual(150, vaImageUntolerant.getNeighbour(2, 3, 3).coords.z);
             }
 
-            Assert::AreEqual(3, vaImageUntolerant(2, 5).neighboursNumber);
+            Assert::AreEqual(3, vaImageUntolerant.getNeighboursNumber(2, 5));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(150, vaImageUntolerant(2, 5).neighbours[0]->coords.z);
-                Assert::AreEqual(150, vaImageUntolerant(2, 5).neighbours[1]->coords.z);
-                Assert::AreEqual(150, vaImageUntolerant(2, 5).neighbours[2]->coords.z);
+                Assert::AreEqual(150, vaImageUntolerant.getNeighbour(2, 5, 0).coords.z);
+                Assert::AreEqual(150, vaImageUntolerant.getNeighbour(2, 5, 1).coords.z);
+                Assert::AreEqual(150, vaImageUntolerant.getNeighbour(2, 5, 2).coords.z);
             }
 
-            Assert::AreEqual(3, vaImageUntolerant(5, 5).neighboursNumber);
+            Assert::AreEqual(3, vaImageUntolerant.getNeighboursNumber(5, 5));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(100, vaImageUntolerant(5, 5).neighbours[0]->coords.z);
-                Assert::AreEqual(100, vaImageUntolerant(5, 5).neighbours[1]->coords.z);
-                Assert::AreEqual(100, vaImageUntolerant(5, 5).neighbours[2]->coords.z);
+                Assert::AreEqual(100, vaImageUntolerant.getNeighbour(5, 5, 0).coords.z);
+                Assert::AreEqual(100, vaImageUntolerant.getNeighbour(5, 5, 1).coords.z);
+                Assert::AreEqual(100, vaImageUntolerant.getNeighbour(5, 5, 2).coords.z);
             }
 
-            Assert::AreEqual(5, vaImageUntolerant(6, 5).neighboursNumber);
+            Assert::AreEqual(5, vaImageUntolerant.getNeighboursNumber(6, 5));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(250, vaImageUntolerant(6, 5).neighbours[0]->coords.z);
-                Assert::AreEqual(250, vaImageUntolerant(6, 5).neighbours[3]->coords.z);
-                Assert::AreEqual(250, vaImageUntolerant(6, 5).neighbours[4]->coords.z);
+                Assert::AreEqual(250, vaImageUntolerant.getNeighbour(6, 5, 0).coords.z);
+                Assert::AreEqual(250, vaImageUntolerant.getNeighbour(6, 5, 3).coords.z);
+                Assert::AreEqual(250, vaImageUntolerant.getNeighbour(6, 5, 4).coords.z);
             }
 
-            Assert::AreEqual(2, vaImageUntolerant(5, 6).neighboursNumber);
+            Assert::AreEqual(2, vaImageUntolerant.getNeighboursNumber(5, 6));
             // Check depths of some neighbours
             {
-                Assert::AreEqual(0, vaImageUntolerant(5, 6).neighbours[0]->coords.z);
-                Assert::AreEqual(0, vaImageUntolerant(5, 6).neighbours[1]->coords.z);
+                Assert::AreEqual(0, vaImageUntolerant.getNeighbour(5, 6, 0).coords.z);
+                Assert::AreEqual(0, vaImageUntolerant.getNeighbour(5, 6, 1).coords.z);
             }
         }
 
@@ -188,7 +250,7 @@ public:
                 int value = vaImageTolerant.getVoxelValue(x, y);
                 Assert::AreEqual(expected, value);
 
-                grl::FFVoxel &voxel = vaImageTolerant.getVoxel(x, y);
+                grl::Voxel voxel = vaImageTolerant.getVoxel(x, y);
                 Assert::AreEqual(x, voxel.coords.x);
                 Assert::AreEqual(y, voxel.coords.y);
                 Assert::AreEqual(expected, voxel.coords.z);
@@ -198,7 +260,7 @@ public:
         va.getSize(width, height);
         for (int y = 0; y < height; ++y) {
             for (int x = 0; x < width; ++x) {
-                grl::FFVoxel &voxel = va.getVoxel(x, y);
+                grl::Voxel voxel = va.getVoxel(x, y);
                 Assert::AreEqual(x, voxel.coords.x);
                 Assert::AreEqual(y, voxel.coords.y);
                 Assert::AreEqual(0, voxel.coords.z);
@@ -213,14 +275,46 @@ public:
         Logger::WriteMessage("----In setters");
 
         // Set some values and then check if they changed properly.
-        va.setVoxelValue(10, 5, 30);
-        Assert::AreEqual(30, va.getVoxelValue(10, 5));
-        Assert::AreEqual(30, va.getVoxel(10, 5).coords.z);
+        va.setVoxelValue(9, 5, 30);
+        Assert::AreEqual(30, va.getVoxelValue(9, 5));
+        Assert::AreEqual(30, va.getVoxel(9, 5).coords.z);
 
         Logger::WriteMessage("----setters Done");
     }
 };
 
+TEST_CLASS(VisitedMapTester)
+{
+public:
+    TEST_METHOD(clear)
+    {
+        grl::VisitedMap map;
+        map.resize(4);
+        map.clear();
+        Assert::IsFalse(map.isVisited(1));
+
+        map.visit(1);
+        Assert::IsTrue(map.isVisited(1));
+        Assert::IsFalse(map.isVisited(2));
+
+        // Clearing many times overflows the stamp, the old marks must not
+        // become visited again.
+        for (int i = 0; i < 65535; ++i) {
+            map.clear();
+            Assert::IsFalse(map.isVisited(1));
+        }
+        map.clear();
+        for (size_t i = 0; i < 4; ++i)
+            Assert::IsFalse(map.isVisited(i));
+
+        // Voxels added by resize are not visited
+        map.visit(3);
+        map.resize(8);
+        Assert::IsTrue(map.isVisited(3));
+        Assert::IsFalse(map.isVisited(7));
+    }
+};
+
 TEST_CLASS(FloodFillClippedTester)
 {
 private:
@@ -250,6 +344,29 @@ public:
         ffUntolerant.init(0, image);
     }
 
+    TEST_METHOD(regionExtraction)
+    {
+        grl::Plane notClippingPlane(grl::Vec3f(0.0f, 0.0f, 1.0f), grl::Vec3f(0.0f, 0.0f, 0.0f));
+        grl::DepthObject object;
+
+        // Region is clipped to the image, so it covers x 5..9 and y 2..5
+        grl::FloodFillClipped ffRegion;
+        ffRegion.init(depthTolerance, image, cv::Rect(5, 2, 10, 4));
+
+        // Starting point outside of the region
+        Assert::IsFalse(ffRegion.extractObject(grl::Vec2i(6, 0), notClippingPlane, object));
+        Assert::AreEqual(static_cast<size_t>(0), object.getSize());
+
+        // Object is cut by the region
+        Assert::IsTrue(ffRegion.extractObject(grl::Vec2i(7, 3), notClippingPlane, object));
+        Assert::AreEqual(3, object.getBoundingBox().width);
+        Assert::AreEqual(4, object.getBoundingBox().height);
+        Assert::AreEqual(6, object.getBoundingBox().x);
+        Assert::AreEqual(2, object.getBoundingBox().y);
+        Assert::AreEqual(static_cast<size_t>(12), object.getSize());
+        Assert::AreEqual(250, object.getMinDepthValue());
+    }
+
     TEST_METHOD(multipleExtraction)
     {
         grl::Plane notClippingPlane(grl::Vec3f(0.0f, 0.0f, 1.0f), grl::Vec3f(0.0f, 0.0f, 0.0f));
@@ -467,6 +584,112 @@ public:
 };
 
 
+TEST_CLASS(ConnectedComponentsTester)
+{
+private:
+    cv::Mat image;
+
+    static constexpr int depthTolerance = 50;
+public:
+    ConnectedComponentsTester()
+    {
+        image = cv::imread("resources/depthmap.png", cv::IMREAD_GRAYSCALE);
+        Assert::IsFalse(image.empty());
+        image.convertTo(image, CV_16UC1);
+
+        Logger::WriteMessage("--In ConnectedComponentsTester");
+    }
+
+    ~ConnectedComponentsTester()
+    {
+        Logger::WriteMessage("--ConnectedComponentsTester Done");
+    }
+
+    TEST_METHOD(stripes)
+    {
+        grl::ConnectedComponents single, striped;
+        single.label(image, depthTolerance, 1);
+        striped.label(image, depthTolerance, 4);
+
+        // Joining the stripes must give the same components
+        Assert::AreEqual(single.getComponentsNumber(), striped.getComponentsNumber());
+        size_t pixels = 0;
+        for (uint32_t component = 0; component < single.getComponentsNumber(); ++component)
+            pixels += single.getComponentSize(component);
+        Assert::AreEqual(static_cast<size_t>(image.cols * image.rows), pixels);
+        for (int y = 0; y < image.rows; ++y) {
+            for (int x = 0; x < image.cols; ++x)
+                Assert::AreEqual(single.getComponent(x, y), striped.getComponent(x, y));
+        }
+    }
+
+    TEST_METHOD(sameAsFloodFill)
+    {
+        grl::Plane notClippingPlane(grl::Vec3f(0.0f, 0.0f, 1.0f), grl::Vec3f(0.0f, 0.0f, 0.0f));
+        grl::ConnectedComponents components;
+        components.label(image, depthTolerance, 3);
+        grl::FloodFillClipped ff;
+        ff.init(depthTolerance, image);
+
+        // Without clipping, the component is the same object as from the
+        // flood fill, from any starting point
+        for (int y = 0; y < image.rows; ++y) {
+            for (int x = 0; x < image.cols; ++x) {
+                grl::DepthObject fromComponents, fromFloodFill;
+                Assert::IsTrue(components.extractObject(grl::Vec2i(x, y), notClippingPlane, fromComponents));
+                Assert::IsTrue(ff.extractObject(grl::Vec2i(x, y), notClippingPlane, fromFloodFill));
+                Assert::AreEqual(fromFloodFill.getSize(), fromComponents.getSize());
+                Assert::IsTrue(fromFloodFill.getBoundingBox() == fromComponents.getBoundingBox());
+                Assert::AreEqual(fromFloodFill.getMinDepthValue(), fromComponents.getMinDepthValue());
+            }
+        }
+
+        grl::DepthObject object;
+        Assert::IsFalse(components.extractObject(grl::Vec2i(10, 0), notClippingPlane, object));
+
+        // The depth grows from the middle column to both sides, so the whole
+        // image is one component. The plane keeps only the pixels at least 2
+        // columns from the middle, the two sides are connected only through
+        // the clipped pixels and only the side of the starting point is
+        // extracted.
+        cv::Mat valley(6, 9, CV_16UC1);
+        for (int y = 0; y < valley.rows; ++y) {
+            for (int x = 0; x < valley.cols; ++x)
+                valley.at<uint16_t>(y, x) = static_cast<uint16_t>(100 + 30 * std::abs(x - 4));
+        }
+        grl::Plane clippingPlane(grl::Vec3f(0.0f, 0.0f, 1.0f), grl::Vec3f(0.0f, 0.0f, 160.0f));
+        components.label(valley, depthTolerance, 2);
+        Assert::AreEqual(static_cast<size_t>(1), components.getComponentsNumber());
+        ff.init(depthTolerance, valley);
+
+        for (int y = 0; y < valley.rows; ++y) {
+            for (int x = 0; x < valley.cols; ++x) {
+                grl::DepthObject fromComponents, fromFloodFill;
+                bool extracted = ff.extractObject(grl::Vec2i(x, y), clippingPlane, fromFloodFill);
+                Assert::AreEqual(extracted, components.extractObject(grl::Vec2i(x, y), clippingPlane, fromComponents));
+                Assert::AreEqual(std::abs(x - 4) >= 2, extracted);
+                Assert::AreEqual(fromFloodFill.getSize(), fromComponents.getSize());
+                Assert::IsTrue(fromFloodFill.getBoundingBox() == fromComponents.getBoundingBox());
+            }
+        }
+        Assert::IsTrue(components.extractObject(grl::Vec2i(0, 0), clippingPlane, object));
+        Assert::AreEqual(static_cast<size_t>(3 * valley.rows), object.getSize());
+        Assert::AreEqual(0, object.getBoundingBox().x);
+
+        // The region limits the object the same way as the flood fill
+        cv::Rect region(1, 1, 4, 3);
+        grl::FloodFillClipped regionFF;
+        regionFF.init(depthTolerance, valley, region);
+        grl::DepthObject fromRegion, fromRegionFF;
+        Assert::IsTrue(components.extractObject(grl::Vec2i(2, 2), clippingPlane, region, fromRegion));
+        Assert::IsTrue(regionFF.extractObject(grl::Vec2i(2, 2), clippingPlane, fromRegionFF));
+        Assert::AreEqual(static_cast<size_t>(6), fromRegion.getSize());
+        Assert::AreEqual(fromRegionFF.getSize(), fromRegion.getSize());
+        Assert::IsTrue(fromRegionFF.getBoundingBox() == fromRegion.getBoundingBox());
+        Assert::IsFalse(components.extractObject(grl::Vec2i(0, 0), clippingPlane, region, object));
+    }
+};
+
 TEST_CLASS(SkeletonExtractorTester)
 {
 private:
@@ -500,17 +723,23 @@ public:
         grl::Joint &lw = skeleton.joints[grl::LEFT_WRIST];
         lw.tracked = true;
         lw.coordDepthImage = grl::Vec2i(0, 8);
+        // 10 pixels per meter, so the regions of the hands are extended by 3
+        // pixels
+        lw.coordWorld = grl::Vec3f(0.0f, 0.8f, 1.0f);
 
         grl::Joint &le = skeleton.joints[grl::LEFT_ELBOW];
         le.tracked = true;
         le.coordDepthImage = grl::Vec2i(4, 8);
+        le.coordWorld = grl::Vec3f(0.4f, 0.8f, 1.0f);
 
         grl::Joint &rw = skeleton.joints[grl::RIGHT_WRIST];
         rw.tracked = true;
         rw.coordDepthImage = grl::Vec2i(7, 0);
+        rw.coordWorld = grl::Vec3f(0.7f, 0.0f, 1.0f);
         grl::Joint &re = skeleton.joints[grl::RIGHT_ELBOW];
         re.tracked = true;
         re.coordDepthImage = grl::Vec2i(7, 8);
+        re.coordWorld = grl::Vec3f(0.7f, 0.8f, 1.0f);
     }
 
     TEST_METHOD(extract)
@@ -539,6 +768,122 @@ public:
         Assert::AreEqual(250, rightHand.getMaxDepthValue());
         Assert::AreEqual(250, rightHand.getMinDepthValue());
     }
+
+    TEST_METHOD(parallelExtract)
+    {
+        grl::DepthObject leftHand, rightHand;
+        extractor.extractHands(image, skeleton, leftHand, rightHand);
+
+        grl::SkeletonExtractorConfig config;
+        config.depthTolerance = depthTolerance;
+        config.parallelHands = true;
+        grl::SkeletonExtractor parallelExtractor;
+        parallelExtractor.init(config);
+
+        // Hands extracted at the same time must be the same as extracted one
+        // after another, also when the extractor is reused
+        for (int i = 0; i < 3; ++i) {
+            grl::DepthObject parallelLeft, parallelRight;
+            parallelExtractor.extractHands(image, skeleton, parallelLeft, parallelRight);
+
+            Assert::AreEqual(leftHand.getAccuracy(), parallelLeft.getAccuracy());
+            Assert::AreEqual(leftHand.getSize(), parallelLeft.getSize());
+            Assert::IsTrue(leftHand.getBoundingBox() == parallelLeft.getBoundingBox());
+            Assert::AreEqual(rightHand.getAccuracy(), parallelRight.getAccuracy());
+            Assert::AreEqual(rightHand.getSize(), parallelRight.getSize());
+            Assert::IsTrue(rightHand.getBoundingBox() == parallelRight.getBoundingBox());
+        }
+    }
+
+    TEST_METHOD(preparedFrame)
+    {
+        grl::DepthObject leftHand, rightHand;
+        extractor.extractHands(image, skeleton, leftHand, rightHand);
+
+        for (int components = 0; components < 2; ++components) {
+            grl::SkeletonExtractorConfig config;
+            config.depthTolerance = depthTolerance;
+            config.parallelHands = true;
+            config.connectedComponents = components != 0;
+            grl::SkeletonExtractor sharedExtractor;
+            sharedExtractor.init(config);
+
+            // Hands of many skeletons are extracted at the same time from the
+            // frame prepared once
+            constexpr size_t skeletonsNum = 4;
+            std::vector<grl::DepthObject> leftHands(skeletonsNum), rightHands(skeletonsNum);
+            sharedExtractor.prepareFrame(image);
+            grl::ThreadPool pool(skeletonsNum);
+            pool.parallelFor(skeletonsNum, [&](size_t i) {
+                sharedExtractor.extractPreparedHands(image, skeleton, leftHands[i], rightHands[i]);
+            });
+
+            for (size_t i = 0; i < skeletonsNum; ++i) {
+                Assert::AreEqual(leftHand.getSize(), leftHands[i].getSize());
+                Assert::IsTrue(leftHand.getBoundingBox() == leftHands[i].getBoundingBox());
+                Assert::AreEqual(rightHand.getSize(), rightHands[i].getSize());
+                Assert::IsTrue(rightHand.getBoundingBox() == rightHands[i].getBoundingBox());
+            }
+        }
+    }
 };
 
+TEST_CLASS(RDFHandSkeletonExtractorTester)
+{
+public:
+    RDFHandSkeletonExtractorTester()
+    {
+        Logger::WriteMessage("--In RDFHandSkeletonExtractorTester");
+    }
+
+    ~RDFHandSkeletonExtractorTester()
+    {
+        Logger::WriteMessage("--RDFHandSkeletonExtractorTester Done");
+    }
+
+    static void saveForest(const std::string &fileName, grl::HandClass handClass)
+    {
+        std::vector<float> probabilities(grl::grlHandIndexNum, 0.0f);
+        probabilities[handClass] = 1.0f;
+        grl::RandomDecisionForest forest(1);
+        forest.getTree(0).setRoot(std::make_unique<grl::Node>(probabilities));
+        forest.saveToFile(fileName);
+    }
+
+    TEST_METHOD(hotSwap)
+    {
+        Logger::WriteMessage("----In hotSwap");
+
+        saveForest("rdf_swap_wrist.txt", grl::grlWristIndex);
+        saveForest("rdf_swap_center.txt", grl::grlCenterIndex);
+
+        grl::RDFHandSkeletonExtractor extractor;
+        Assert::IsTrue(extractor.init("rdf_swap_wrist.txt"));
+        std::shared_ptr<const grl::RandomDecisionForest> frameForest = extractor.getForest();
+        Assert::IsTrue(frameForest != nullptr);
+
+        // Frame that started before the swap keeps its forest
+        Assert::IsTrue(extractor.loadForestAsync("rdf_swap_center.txt").get());
+        std::shared_ptr<const grl::RandomDecisionForest> newForest = extractor.getForest();
+        Assert::IsTrue(newForest != frameForest);
+        Assert::AreEqual(1.0f, frameForest->getTree(0).getRoot()->getProbabilities()[grl::grlWristIndex]);
+        Assert::AreEqual(1.0f, newForest->getTree(0).getRoot()->getProbabilities()[grl::grlCenterIndex]);
+
+        // Broken file keeps the current forest
+        Assert::IsFalse(extractor.loadForestAsync("rdf_swap_missing.txt").get());
+        Assert::IsTrue(extractor.getForest() == newForest);
+
+        // Loads are applied in the order of the requests
+        std::future<bool> first = extractor.loadForestAsync("rdf_swap_center.txt");
+        std::future<bool> second = extractor.loadForestAsync("rdf_swap_wrist.txt");
+        Assert::IsTrue(first.get());
+        Assert::IsTrue(second.get());
+        Assert::AreEqual(1.0f, extractor.getForest()->getTree(0).getRoot()->getProbabilities()[grl::grlWristIndex]);
+
+        std::remove("rdf_swap_wrist.txt");
+        std::remove("rdf_swap_center.txt");
+
+        Logger::WriteMessage("----hotSwap Done");
+    }
+};
 }
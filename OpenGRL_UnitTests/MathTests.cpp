@@ -3,6 +3,8 @@
 
 #include <grl/utils/MathUtils.h>
 
+#include <cmath>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 
@@ -733,6 +735,33 @@ public:
         Logger::WriteMessage("----isOnPlane Done");
     }
 
+    TEST_METHOD(classify)
+    {
+        Logger::WriteMessage("----In classify");
+
+        // Length of the run is not a multiple of the vector width, so both
+        // the vectorized and the scalar part are used
+        constexpr int count = 29;
+        uint16_t depths[count];
+        for (int i = 0; i < count; ++i)
+            depths[i] = static_cast<uint16_t>((i * 37) % 23);
+
+        grl::Plane planes[] = { plane, planeXY, planeXZ, planeYZ, planeXYInv };
+        for (grl::Plane &tested : planes) {
+            for (int y = -6; y <= 2; y += 4) {
+                uint8_t mask[count];
+                tested.classify(-10, y, depths, count, mask);
+                for (int i = 0; i < count; ++i) {
+                    grl::Vec3f point(static_cast<float>(-10 + i), static_cast<float>(y),
+                                     static_cast<float>(depths[i]));
+                    Assert::AreEqual(tested(point) >= 0.0f ? 1 : 0, static_cast<int>(mask[i]));
+                }
+            }
+        }
+
+        Logger::WriteMessage("----classify Done");
+    }
+
     TEST_METHOD(fromPoints)
     {
         Logger::WriteMessage("----In fromPoints");
@@ -804,4 +833,39 @@ public:
     }
 };
 
+TEST_CLASS(GaussianKernelTester)
+{
+private:
+    static constexpr float floatTolerance = 0.0001f;
+public:
+    GaussianKernelTester()
+    {
+        Logger::WriteMessage("--In GaussianKernelTester");
+    }
+
+    ~GaussianKernelTester()
+    {
+        Logger::WriteMessage("--GaussianKernelTester done");
+    }
+
+    TEST_METHOD(separable)
+    {
+        Logger::WriteMessage("----In separable");
+
+        grl::GaussianKernel kernel(4.0f, 9);
+        Assert::AreEqual(static_cast<size_t>(9), kernel.getSize());
+        Assert::AreEqual(1.0f, kernel.getProfile(4), floatTolerance);
+        Assert::AreEqual(std::exp(-1.0f), kernel.getProfile(0), floatTolerance);
+        Assert::AreEqual(kernel.getProfile(0), kernel.getProfile(8), floatTolerance);
+
+        // The 2D kernel is the product of the 1D kernels
+        for (int y = 0; y < 9; ++y) {
+            for (int x = 0; x < 9; ++x)
+                Assert::AreEqual(kernel(x, y), kernel.getProfile(x) * kernel.getProfile(y), floatTolerance);
+        }
+
+        Logger::WriteMessage("----separable Done");
+    }
+};
+
 }
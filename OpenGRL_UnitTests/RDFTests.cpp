@@ -0,0 +1,952 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <grl/rdf/CPUTrainingBackend.h>
+#include <grl/rdf/DecisionTree.h>
+#include <grl/rdf/Entropy.h>
+#include <grl/rdf/ForegroundSampler.h>
+#include <grl/rdf/ForestEvaluator.h>
+#include <grl/rdf/RandomStream.h>
+#include <grl/rdf/RDFUtils.h>
+#include <grl/rdf/TrainingMemory.h>
+#include <grl/rdf/TrainingMetrics.h>
+#include <grl/utils/RGBTools.h>
+
+#include <opencv2/highgui/highgui.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace OpenGRL_UnitTests_RDF {
+TEST_CLASS(RDFToolsTester)
+{
+private:
+    cv::Mat classRGBImage;
+
+    static void setColor(cv::Mat &image, int x, int y, uint32_t rgb)
+    {
+        uint8_t b, g, r;
+        grl::rgb2val(rgb, b, g, r);
+        image.at<cv::Vec3b>(y, x) = cv::Vec3b(b, g, r);
+    }
+public:
+    RDFToolsTester()
+    {
+        Logger::WriteMessage("--In RDFToolsTester");
+    }
+
+    ~RDFToolsTester()
+    {
+        Logger::WriteMessage("--RDFToolsTester Done");
+    }
+
+    TEST_METHOD_INITIALIZE(prepareImage)
+    {
+        // Black image with few pixels of the classes and one unknown color
+        classRGBImage = cv::Mat::zeros(12, 10, CV_8UC3);
+        setColor(classRGBImage, 2, 3, grl::grlWristColor);
+        setColor(classRGBImage, 3, 3, grl::grlPinkyTipColor);
+        setColor(classRGBImage, 7, 4, grl::grlMiddleBaseColor);
+        setColor(classRGBImage, 5, 8, 0x123456);
+        setColor(classRGBImage, 4, 9, grl::grlThumbTipColor);
+    }
+
+    TEST_METHOD(rgbToHandClass)
+    {
+        Logger::WriteMessage("----In rgbToHandClass");
+
+        Assert::AreEqual(static_cast<int8_t>(grl::grlBackgroundIndex),
+                         grl::RDFTools::rgbToHandClass(grl::grlBackgroundColor));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlWristIndex),
+                         grl::RDFTools::rgbToHandClass(grl::grlWristColor));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlCenterIndex),
+                         grl::RDFTools::rgbToHandClass(grl::grlCenterColor));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlThumbBaseIndex),
+                         grl::RDFTools::rgbToHandClass(grl::grlThumbBaseColor));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlMiddleBaseIndex),
+                         grl::RDFTools::rgbToHandClass(grl::grlMiddleBaseColor));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlRingTipIndex),
+                         grl::RDFTools::rgbToHandClass(grl::grlRingTipColor));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlPinkyTipIndex),
+                         grl::RDFTools::rgbToHandClass(grl::grlPinkyTipColor));
+
+        // Colors not used by any class
+        Assert::AreEqual(static_cast<int8_t>(grl::grlUnknownIndex),
+                         grl::RDFTools::rgbToHandClass(0x123456));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlUnknownIndex),
+                         grl::RDFTools::rgbToHandClass(0xFFFFFF));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlUnknownIndex),
+                         grl::RDFTools::rgbToHandClass(0x000001));
+
+        Logger::WriteMessage("----rgbToHandClass Done");
+    }
+
+    TEST_METHOD(convertCropped)
+    {
+        Logger::WriteMessage("----In convertCropped");
+
+        cv::Mat classes;
+        cv::Rect bb = grl::RDFTools::convertRGBToHandClassesCropped(classRGBImage, classes);
+
+        // The box must be the same as the one from the separate search
+        cv::Rect expectedBB = grl::getBoundingBoxRGB(classRGBImage);
+        Assert::AreEqual(expectedBB.x, bb.x);
+        Assert::AreEqual(expectedBB.y, bb.y);
+        Assert::AreEqual(expectedBB.width, bb.width);
+        Assert::AreEqual(expectedBB.height, bb.height);
+
+        // And the classes must be the same as for the full conversion
+        cv::Mat expectedClasses;
+        grl::RDFTools::convertRGBToHandClasses(classRGBImage(bb), expectedClasses);
+        Assert::AreEqual(expectedClasses.rows, classes.rows);
+        Assert::AreEqual(expectedClasses.cols, classes.cols);
+        for (int y = 0; y < classes.rows; ++y) {
+            for (int x = 0; x < classes.cols; ++x)
+                Assert::AreEqual(expectedClasses.at<int8_t>(y, x), classes.at<int8_t>(y, x));
+        }
+
+        Assert::AreEqual(static_cast<int8_t>(grl::grlWristIndex), classes.at<int8_t>(3 - bb.y, 2 - bb.x));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlPinkyTipIndex), classes.at<int8_t>(3 - bb.y, 3 - bb.x));
+        Assert::AreEqual(static_cast<int8_t>(grl::grlUnknownIndex), classes.at<int8_t>(8 - bb.y, 5 - bb.x));
+
+        // Nothing to find on the black image
+        cv::Rect empty = grl::RDFTools::convertRGBToHandClassesCropped(
+            cv::Mat::zeros(5, 5, CV_8UC3), classes);
+        Assert::AreEqual(0, empty.area());
+        Assert::IsTrue(classes.empty());
+
+        Logger::WriteMessage("----convertCropped Done");
+    }
+
+    TEST_METHOD(parallelLoading)
+    {
+        Logger::WriteMessage("----In parallelLoading");
+
+        // Few images differing in the position of one class pixel and depth
+        for (int i = 1; i <= 6; ++i) {
+            cv::Mat classes = classRGBImage.clone();
+            setColor(classes, 3 + i % 4, 4 + i / 2, grl::grlRingTipColor);
+            cv::Mat depth(classes.rows, classes.cols, CV_32FC3);
+            for (int y = 0; y < depth.rows; ++y) {
+                for (int x = 0; x < depth.cols; ++x)
+                    depth.at<cv::Vec3f>(y, x) = cv::Vec3f(static_cast<float>(x + y*depth.cols + i), 0.0f, 0.0f);
+            }
+            std::string id = "0" + std::to_string(i);
+            cv::imwrite("loader_classes_" + id + ".png", classes);
+            cv::imwrite("loader_depth_" + id + ".exr", depth);
+        }
+
+        std::vector<cv::Mat> classImages, depthImages;
+        grl::RDFTools::loadDepthImagesWithClasses(1, 7, 1, 2, "loader_classes_", "loader_depth_",
+                                                  classImages, depthImages);
+
+        std::vector<cv::Mat> parallelClasses, parallelDepths;
+        std::vector<uint32_t> loadedIDs;
+        grl::RDFTools::loadDepthImagesWithClassesParallel(1, 7, 1, 2, "loader_classes_", "loader_depth_",
+            parallelClasses, parallelDepths, 3,
+            [&loadedIDs](uint32_t imgID, const cv::Mat &, const cv::Mat &) { loadedIDs.push_back(imgID); });
+
+        // Same images in the same order as from the sequential loader
+        Assert::AreEqual(static_cast<size_t>(6), classImages.size());
+        Assert::AreEqual(classImages.size(), parallelClasses.size());
+        Assert::AreEqual(depthImages.size(), parallelDepths.size());
+        Assert::AreEqual(classImages.size(), loadedIDs.size());
+        for (size_t n = 0; n < classImages.size(); ++n) {
+            Assert::AreEqual(static_cast<uint32_t>(n), loadedIDs[n]);
+            Assert::AreEqual(classImages[n].rows, parallelClasses[n].rows);
+            Assert::AreEqual(classImages[n].cols, parallelClasses[n].cols);
+            Assert::AreEqual(0.0, cv::norm(classImages[n], parallelClasses[n], cv::NORM_INF));
+            Assert::AreEqual(depthImages[n].rows, parallelDepths[n].rows);
+            Assert::AreEqual(depthImages[n].cols, parallelDepths[n].cols);
+            Assert::AreEqual(0.0, cv::norm(depthImages[n], parallelDepths[n], cv::NORM_INF));
+        }
+
+        // The depth of the last image is missing, the error must reach the
+        // caller instead of leaving the consumer waiting
+        cv::imwrite("loader_classes_07.png", classRGBImage);
+        std::vector<cv::Mat> failedClasses, failedDepths;
+        Assert::ExpectException<cv::Exception>([&]() {
+            grl::RDFTools::loadDepthImagesWithClassesParallel(1, 8, 1, 2, "loader_classes_", "loader_depth_",
+                failedClasses, failedDepths, 3,
+                [](uint32_t, const cv::Mat &, const cv::Mat &) {});
+        });
+
+        for (int i = 1; i <= 7; ++i) {
+            std::string id = "0" + std::to_string(i);
+            std::remove(("loader_classes_" + id + ".png").c_str());
+            std::remove(("loader_depth_" + id + ".exr").c_str());
+        }
+
+        Logger::WriteMessage("----parallelLoading Done");
+    }
+};
+
+TEST_CLASS(ForegroundSamplerTester)
+{
+private:
+    cv::Mat classImage;
+public:
+    ForegroundSamplerTester()
+    {
+        Logger::WriteMessage("--In ForegroundSamplerTester");
+    }
+
+    ~ForegroundSamplerTester()
+    {
+        Logger::WriteMessage("--ForegroundSamplerTester Done");
+    }
+
+    TEST_METHOD_INITIALIZE(prepareImage)
+    {
+        // 20 wrist pixels, 6 center pixels and 2 thumb tip pixels
+        classImage = cv::Mat(40, 30, CV_8SC1, cv::Scalar(grl::grlBackgroundIndex));
+        classImage(cv::Rect(5, 5, 10, 2)).setTo(cv::Scalar(grl::grlWristIndex));
+        classImage(cv::Rect(20, 30, 3, 2)).setTo(cv::Scalar(grl::grlCenterIndex));
+        classImage.at<int8_t>(39, 29) = grl::grlThumbTipIndex;
+        classImage.at<int8_t>(0, 0) = grl::grlThumbTipIndex;
+    }
+
+    TEST_METHOD(foregroundList)
+    {
+        Logger::WriteMessage("----In foregroundList");
+
+        grl::ForegroundSampler sampler(classImage);
+        Assert::AreEqual(static_cast<size_t>(28), sampler.getForegroundSize());
+        Assert::AreEqual(static_cast<size_t>(20), sampler.getClassSize(grl::grlWristIndex));
+        Assert::AreEqual(static_cast<size_t>(6), sampler.getClassSize(grl::grlCenterIndex));
+        Assert::AreEqual(static_cast<size_t>(2), sampler.getClassSize(grl::grlThumbTipIndex));
+        Assert::AreEqual(static_cast<size_t>(0), sampler.getClassSize(grl::grlPinkyTipIndex));
+        Assert::AreEqual(static_cast<size_t>(0), sampler.getClassSize(grl::grlBackgroundIndex));
+
+        Logger::WriteMessage("----foregroundList Done");
+    }
+
+    TEST_METHOD(exactSampling)
+    {
+        Logger::WriteMessage("----In exactSampling");
+
+        grl::ForegroundSampler sampler(classImage);
+        grl::RandomStream stream(7);
+        std::vector<cv::Point> samples;
+        std::vector<uint32_t> scratch;
+
+        // Distinct foreground pixels only
+        sampler.sample(15, false, stream, samples, scratch);
+        Assert::AreEqual(static_cast<size_t>(15), samples.size());
+        std::set<std::pair<int, int> > unique;
+        for (auto it = samples.cbegin(); it != samples.cend(); ++it) {
+            Assert::AreNotEqual(static_cast<int8_t>(grl::grlBackgroundIndex), classImage.at<int8_t>(*it));
+            unique.insert(std::make_pair(it->x, it->y));
+        }
+        Assert::AreEqual(samples.size(), unique.size());
+
+        // Asking for more than there is returns the whole foreground
+        samples.clear();
+        sampler.sample(100, false, stream, samples, scratch);
+        Assert::AreEqual(static_cast<size_t>(28), samples.size());
+
+        Logger::WriteMessage("----exactSampling Done");
+    }
+
+    TEST_METHOD(stratifiedSampling)
+    {
+        Logger::WriteMessage("----In stratifiedSampling");
+
+        grl::ForegroundSampler sampler(classImage);
+        grl::RandomStream stream(7);
+        std::vector<cv::Point> samples;
+        std::vector<uint32_t> scratch;
+
+        // Thumb tip has only 2 pixels, the rest of its share goes to the others
+        sampler.sample(15, true, stream, samples, scratch);
+        Assert::AreEqual(static_cast<size_t>(15), samples.size());
+
+        std::array<int, grl::grlHandIndexNum> counts = {};
+        for (auto it = samples.cbegin(); it != samples.cend(); ++it)
+            ++counts[classImage.at<int8_t>(*it)];
+        Assert::AreEqual(2, counts[grl::grlThumbTipIndex]);
+        Assert::AreEqual(6, counts[grl::grlCenterIndex]);
+        Assert::AreEqual(7, counts[grl::grlWristIndex]);
+
+        Logger::WriteMessage("----stratifiedSampling Done");
+    }
+};
+
+TEST_CLASS(EntropyTableTester)
+{
+private:
+    static double getEntropy(const grl::ClassCounts &counts)
+    {
+        double n = grl::getCountsSum(counts);
+        double entropy = 0.0;
+        for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+            if (*it != 0)
+                entropy -= (*it / n) * std::log2(*it / n);
+        }
+        return entropy;
+    }
+public:
+    EntropyTableTester()
+    {
+        Logger::WriteMessage("--In EntropyTableTester");
+    }
+
+    ~EntropyTableTester()
+    {
+        Logger::WriteMessage("--EntropyTableTester Done");
+    }
+
+    TEST_METHOD(gain)
+    {
+        Logger::WriteMessage("----In gain");
+
+        const grl::EntropyTable &table = grl::EntropyTable::getInstance();
+        Assert::AreEqual(0.0, table.nlog2n(0));
+        Assert::AreEqual(0.0, table.nlog2n(1));
+        Assert::AreEqual(8.0, table.nlog2n(4), 1e-12);
+        Assert::AreEqual(grl::EntropyTable::tableSize * 20.0, table.nlog2n(grl::EntropyTable::tableSize), 1e-6);
+
+        grl::ClassCounts parent = {}, left = {}, right = {};
+        parent[grl::grlWristIndex] = 120;
+        parent[grl::grlCenterIndex] = 45;
+        parent[grl::grlPinkyTipIndex] = 7;
+        left[grl::grlWristIndex] = 100;
+        left[grl::grlCenterIndex] = 5;
+        left[grl::grlPinkyTipIndex] = 7;
+        for (size_t i = 0; i < parent.size(); ++i)
+            right[i] = parent[i] - left[i];
+
+        // The same as the gain calculated on the probabilities
+        double n = grl::getCountsSum(parent);
+        double expected = getEntropy(parent)
+            - grl::getCountsSum(left) / n * getEntropy(left)
+            - grl::getCountsSum(right) / n * getEntropy(right);
+        Assert::AreEqual(expected, table.getGain(parent, left), 1e-9);
+        Assert::AreEqual(n * getEntropy(parent), table.getScaledEntropy(parent), 1e-9);
+
+        // Nothing is gained if the split does not separate anything
+        Assert::AreEqual(0.0, table.getGain(parent, grl::ClassCounts{}), 1e-9);
+
+        // Perfect split of two classes gains the whole entropy
+        grl::ClassCounts twoClasses = {}, oneClass = {};
+        twoClasses[grl::grlWristIndex] = 10;
+        twoClasses[grl::grlCenterIndex] = 10;
+        oneClass[grl::grlWristIndex] = 10;
+        Assert::AreEqual(1.0, table.getGain(twoClasses, oneClass), 1e-12);
+
+        Logger::WriteMessage("----gain Done");
+    }
+};
+
+TEST_CLASS(RandomStreamTester)
+{
+public:
+    RandomStreamTester()
+    {
+        Logger::WriteMessage("--In RandomStreamTester");
+    }
+
+    ~RandomStreamTester()
+    {
+        Logger::WriteMessage("--RandomStreamTester Done");
+    }
+
+    TEST_METHOD(reproducible)
+    {
+        Logger::WriteMessage("----In reproducible");
+
+        grl::RandomStream a(42), b(42);
+        std::vector<uint32_t> numbers;
+        for (int i = 0; i < 100; ++i) {
+            numbers.push_back(a());
+            Assert::AreEqual(numbers.back(), b());
+        }
+
+        // Any number can be reached without generating the previous ones
+        grl::RandomStream c(42);
+        c.seek(57);
+        Assert::AreEqual(numbers[57], c());
+
+        // Substreams differ from each other and from the parent
+        grl::RandomStream first = a.getSubstream(1);
+        grl::RandomStream second = a.getSubstream(2);
+        grl::RandomStream parent(42);
+        int same = 0;
+        for (int i = 0; i < 100; ++i) {
+            uint32_t x = first(), y = second(), z = parent();
+            same += (x == y) + (x == z);
+        }
+        Assert::AreEqual(0, same);
+
+        Logger::WriteMessage("----reproducible Done");
+    }
+
+    TEST_METHOD(distributions)
+    {
+        Logger::WriteMessage("----In distributions");
+
+        grl::RandomStream stream(3);
+        std::array<int, 7> histogram = {};
+        for (int i = 0; i < 7000; ++i) {
+            int value = stream.uniformInt(-3, 3);
+            Assert::IsTrue(value >= -3 && value <= 3);
+            ++histogram[value + 3];
+
+            float real = stream.uniformReal(-0.5f, 0.5f);
+            Assert::IsTrue(real >= -0.5f && real < 0.5f);
+        }
+        for (auto it = histogram.cbegin(); it != histogram.cend(); ++it)
+            Assert::IsTrue(*it > 850 && *it < 1150);
+
+        Logger::WriteMessage("----distributions Done");
+    }
+
+    TEST_METHOD(candidatesIndependent)
+    {
+        Logger::WriteMessage("----In candidatesIndependent");
+
+        // Generating the candidates backwards gives the same decisions
+        grl::RandomStream stream(11);
+        std::vector<grl::Decision> forward, backward(50);
+        for (int i = 0; i < 50; ++i)
+            forward.push_back(grl::DecisionTree::getCandidate(stream, 5, i));
+        for (int i = 49; i >= 0; --i)
+            backward[i] = grl::DecisionTree::getCandidate(stream, 5, i);
+
+        for (int i = 0; i < 50; ++i) {
+            Assert::AreEqual(forward[i].u.x, backward[i].u.x);
+            Assert::AreEqual(forward[i].u.y, backward[i].u.y);
+            Assert::AreEqual(forward[i].v.x, backward[i].v.x);
+            Assert::AreEqual(forward[i].v.y, backward[i].v.y);
+            Assert::AreEqual(forward[i].t, backward[i].t);
+        }
+
+        // Other node gets other candidates
+        grl::Decision other = grl::DecisionTree::getCandidate(stream, 6, 0);
+        Assert::IsFalse(other.t == forward[0].t);
+
+        Logger::WriteMessage("----candidatesIndependent Done");
+    }
+};
+
+TEST_CLASS(DecisionTreeTester)
+{
+public:
+    DecisionTreeTester()
+    {
+        Logger::WriteMessage("--In DecisionTreeTester");
+    }
+
+    ~DecisionTreeTester()
+    {
+        Logger::WriteMessage("--DecisionTreeTester Done");
+    }
+
+    TEST_METHOD(refitLeaves)
+    {
+        Logger::WriteMessage("----In refitLeaves");
+
+        grl::Decision decision = {};
+        std::vector<float> uniform(grl::grlHandIndexNum, 1.0f / grl::grlHandIndexNum);
+        std::unique_ptr<grl::Node> root = std::make_unique<grl::Node>(decision);
+        root->setLeft(std::make_unique<grl::Node>(uniform, root.get()));
+        root->setRight(std::make_unique<grl::Node>(uniform, root.get()));
+        const grl::Node *left = root->getLeft();
+        const grl::Node *right = root->getRight();
+
+        grl::DecisionTree tree;
+        tree.setRoot(std::move(root));
+
+        grl::LeafCounts counts;
+        counts[left][grl::grlWristIndex] = 3;
+        counts[left][grl::grlCenterIndex] = 1;
+        tree.refitLeaves(counts);
+
+        // Reached leaf gets the new distribution, the other one is kept
+        Assert::AreEqual(0.75f, left->getProbabilities()[grl::grlWristIndex]);
+        Assert::AreEqual(0.25f, left->getProbabilities()[grl::grlCenterIndex]);
+        Assert::AreEqual(0.0f, left->getProbabilities()[grl::grlPinkyTipIndex]);
+        Assert::IsTrue(right->getProbabilities() == uniform);
+        Assert::IsFalse(tree.getRoot()->isLeaf());
+
+        Logger::WriteMessage("----refitLeaves Done");
+    }
+};
+
+TEST_CLASS(ForestFileTester)
+{
+public:
+    ForestFileTester()
+    {
+        Logger::WriteMessage("--In ForestFileTester");
+    }
+
+    ~ForestFileTester()
+    {
+        Logger::WriteMessage("--ForestFileTester Done");
+    }
+
+    static float getLeafProbability(const grl::RandomDecisionForest &forest, size_t tree)
+    {
+        return forest.getTree(tree).getRoot()->getProbabilities()[grl::grlWristIndex];
+    }
+
+    TEST_METHOD(indexedLoading)
+    {
+        Logger::WriteMessage("----In indexedLoading");
+
+        grl::RandomDecisionForest forest(5);
+        for (size_t i = 0; i < forest.getSize(); ++i) {
+            std::vector<float> probabilities(grl::grlHandIndexNum, 0.0f);
+            probabilities[grl::grlWristIndex] = 0.1f * (i + 1);
+            forest.getTree(i).setRoot(std::make_unique<grl::Node>(probabilities));
+        }
+        forest.saveToFile("rdf_indexed.txt");
+        Assert::IsTrue(std::ifstream("rdf_indexed.txt.idx").is_open());
+
+        // Trees are parsed in parallel using the index
+        grl::RandomDecisionForest indexed;
+        Assert::IsTrue(indexed.loadFromFile("rdf_indexed.txt"));
+        Assert::AreEqual(forest.getSize(), indexed.getSize());
+        for (size_t i = 0; i < forest.getSize(); ++i)
+            Assert::AreEqual(getLeafProbability(forest, i), getLeafProbability(indexed, i));
+
+        // The trees are rewritten without changing the size of the file, the
+        // checksum does not match and the index is not used
+        {
+            std::ifstream file("rdf_indexed.txt");
+            std::stringstream content;
+            content << file.rdbuf();
+            std::string swapped = content.str();
+            size_t first = swapped.find("\n0.1\n");
+            size_t second = swapped.find("\n0.2\n");
+            swapped.replace(first, 5, "\n0.2\n");
+            swapped.replace(second, 5, "\n0.1\n");
+            file.close();
+            std::ofstream("rdf_indexed.txt") << swapped;
+        }
+        grl::RandomDecisionForest rewritten;
+        Assert::IsTrue(rewritten.loadFromFile("rdf_indexed.txt"));
+        Assert::AreEqual(getLeafProbability(forest, 1), getLeafProbability(rewritten, 0));
+        Assert::AreEqual(getLeafProbability(forest, 0), getLeafProbability(rewritten, 1));
+
+        // The file changed after the index was saved, it is read sequentially
+        {
+            std::ofstream file("rdf_indexed.txt", std::ofstream::app);
+            file << "T5\n>L\n#1\n0.7\n.U\n";
+        }
+        grl::RandomDecisionForest sequential;
+        Assert::IsTrue(sequential.loadFromFile("rdf_indexed.txt"));
+        Assert::AreEqual(static_cast<size_t>(6), sequential.getSize());
+        Assert::AreEqual(0.7f, getLeafProbability(sequential, 5));
+
+        // Old files without the index
+        std::remove("rdf_indexed.txt.idx");
+        grl::RandomDecisionForest old;
+        Assert::IsTrue(old.loadFromFile("rdf_indexed.txt"));
+        Assert::AreEqual(static_cast<size_t>(6), old.getSize());
+
+        std::remove("rdf_indexed.txt");
+
+        Logger::WriteMessage("----indexedLoading Done");
+    }
+};
+
+TEST_CLASS(ForestEvaluatorTester)
+{
+public:
+    ForestEvaluatorTester()
+    {
+        Logger::WriteMessage("--In ForestEvaluatorTester");
+    }
+
+    ~ForestEvaluatorTester()
+    {
+        Logger::WriteMessage("--ForestEvaluatorTester Done");
+    }
+
+    TEST_METHOD(confusionAndPoses)
+    {
+        Logger::WriteMessage("----In confusionAndPoses");
+
+        // Forest always answering wrist
+        std::vector<float> wrist(grl::grlHandIndexNum, 0.0f);
+        wrist[grl::grlWristIndex] = 1.0f;
+        grl::RandomDecisionForest forest(1);
+        forest.getTree(0).setRoot(std::make_unique<grl::Node>(wrist));
+
+        // Left half of the image is the hand, top of it is the wrist and the
+        // bottom is the center
+        std::vector<cv::Mat> classImages;
+        std::vector<cv::Mat> depthImages;
+        for (int i = 0; i < 4; ++i) {
+            cv::Mat depth = cv::Mat::zeros(8, 8, CV_32FC1);
+            cv::Mat classes(8, 8, CV_8SC1, cv::Scalar(grl::grlBackgroundIndex));
+            for (int y = 0; y < 8; ++y) {
+                for (int x = 0; x < 4; ++x) {
+                    depth.at<float>(y, x) = 1.0f;
+                    classes.at<int8_t>(y, x) = y < 4 + i % 2 ? grl::grlWristIndex : grl::grlCenterIndex;
+                }
+            }
+            depthImages.push_back(depth);
+            classImages.push_back(classes);
+        }
+
+        grl::ForestEvaluator evaluator(forest);
+        Assert::IsTrue(evaluator.evaluate(classImages, depthImages, { 0, 1, 0, 1 }, 2));
+
+        const grl::ConfusionMatrix &confusion = evaluator.getConfusionMatrix();
+        Assert::AreEqual(static_cast<uint64_t>(16 + 20 + 16 + 20),
+                         confusion[grl::grlWristIndex][grl::grlWristIndex]);
+        Assert::AreEqual(static_cast<uint64_t>(16 + 12 + 16 + 12),
+                         confusion[grl::grlCenterIndex][grl::grlWristIndex]);
+        Assert::AreEqual(static_cast<uint64_t>(0),
+                         confusion[grl::grlEvaluationBackground][grl::grlWristIndex]);
+        Assert::AreEqual(static_cast<uint64_t>(128), evaluator.getPixelsNum());
+        Assert::AreEqual(0.5, evaluator.getPoseAccuracy(0), 1e-9);
+        Assert::AreEqual(0.625, evaluator.getPoseAccuracy(1), 1e-9);
+        Assert::AreEqual(static_cast<size_t>(4), evaluator.getImagesNum());
+        Assert::IsTrue(evaluator.getLatency(50.0) <= evaluator.getLatency(99.0));
+
+        // Sizes must match
+        Assert::IsFalse(evaluator.evaluate(classImages, depthImages, { 0 }));
+
+        Logger::WriteMessage("----confusionAndPoses Done");
+    }
+};
+
+TEST_CLASS(TrainingMemoryTester)
+{
+public:
+    TrainingMemoryTester()
+    {
+        Logger::WriteMessage("--In TrainingMemoryTester");
+    }
+
+    ~TrainingMemoryTester()
+    {
+        Logger::WriteMessage("--TrainingMemoryTester Done");
+    }
+
+    TEST_METHOD(tracker)
+    {
+        Logger::WriteMessage("----In tracker");
+
+        grl::TreeMemoryTracker memory;
+        memory.allocate(100);
+        memory.allocate(50);
+        memory.release(120);
+        memory.allocate(60);
+        Assert::AreEqual(static_cast<size_t>(90), memory.getCurrent());
+        Assert::AreEqual(static_cast<size_t>(150), memory.getPeak());
+
+        // Pixels are accounted by their capacity
+        grl::TrainingPixels pixels;
+        pixels.reserve(10);
+        Assert::AreEqual(10 * grl::TrainingPixels::bytesPerPixel, pixels.getMemorySize());
+
+        Logger::WriteMessage("----tracker Done");
+    }
+
+    TEST_METHOD(budget)
+    {
+        Logger::WriteMessage("----In budget");
+
+        grl::TrainingMemoryBudget budget(100);
+        budget.acquire(60);
+        budget.acquire(40);
+
+        // The second tree is started once the first one is done
+        std::atomic<bool> started(false);
+        std::thread waiting([&]() {
+            budget.acquire(30);
+            started = true;
+            budget.release(30);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        Assert::IsFalse(started);
+        budget.release(60);
+        waiting.join();
+        Assert::IsTrue(started);
+        budget.release(40);
+
+        // Too big tree runs alone instead of waiting forever
+        budget.acquire(500);
+        budget.release(500);
+
+        Logger::WriteMessage("----budget Done");
+    }
+};
+
+TEST_CLASS(TrainingMetricsTester)
+{
+public:
+    TrainingMetricsTester()
+    {
+        Logger::WriteMessage("--In TrainingMetricsTester");
+    }
+
+    ~TrainingMetricsTester()
+    {
+        Logger::WriteMessage("--TrainingMetricsTester Done");
+    }
+
+    TEST_METHOD(depthTotals)
+    {
+        Logger::WriteMessage("----In depthTotals");
+
+        std::ostringstream log;
+        grl::TrainingMetrics metrics(grl::grlTrainingVerbosityQuiet, log);
+
+        std::vector<grl::NodeMetrics> nodes(3);
+        nodes[0] = { 1, 1, 100, 10, 0.5, 2.0 };
+        nodes[1] = { 2, 2, 60, 0, std::numeric_limits<double>::quiet_NaN(), 0.0 };
+        nodes[2] = { 3, 2, 40, 10, 0.25, 1.0 };
+        Assert::AreEqual(500.0, nodes[0].getEvaluationsPerSecond(), 1e-9);
+
+        grl::TreeMetrics tree = {};
+        tree.tree = 0;
+        tree.backend = "CPU";
+        metrics.addTree(tree, nodes);
+        tree.tree = 1;
+        metrics.addTree(tree, nodes);
+
+        std::vector<grl::TrainingMetrics::DepthTotals> depths = metrics.getDepthTotals();
+        Assert::AreEqual(static_cast<size_t>(2), depths.size());
+        Assert::AreEqual(static_cast<size_t>(2), depths[0].nodes);
+        Assert::AreEqual(static_cast<size_t>(4), depths[1].nodes);
+        Assert::AreEqual(static_cast<size_t>(200), depths[1].pixels);
+        Assert::AreEqual(static_cast<uint64_t>(800), depths[1].evaluations);
+        Assert::AreEqual(4.0, depths[0].seconds, 1e-9);
+
+        // Nothing is printed when quiet
+        metrics.printDepthSummary();
+        Assert::IsTrue(log.str().empty());
+
+        Logger::WriteMessage("----depthTotals Done");
+    }
+};
+
+TEST_CLASS(TrainingBackendTester)
+{
+private:
+    std::vector<cv::Mat> depthImages;
+    grl::TrainingPixels pixels;
+public:
+    TrainingBackendTester()
+    {
+        Logger::WriteMessage("--In TrainingBackendTester");
+    }
+
+    ~TrainingBackendTester()
+    {
+        Logger::WriteMessage("--TrainingBackendTester Done");
+    }
+
+    TEST_METHOD_INITIALIZE(preparePixels)
+    {
+        // Random depth with some background and pixels of different depths,
+        // including ones for which the offsets are rounded from x.5
+        std::mt19937 gen(3);
+        std::uniform_real_distribution<float> depthRand(0.0f, 3.0f);
+        depthImages.clear();
+        for (int i = 0; i < 3; ++i) {
+            // Rows of the images are longer than their width
+            cv::Mat depth = cv::Mat(40, 36, CV_32FC1)(cv::Rect(0, 0, 30, 40));
+            for (int y = 0; y < depth.rows; ++y) {
+                for (int x = 0; x < depth.cols; ++x) {
+                    float d = depthRand(gen);
+                    depth.at<float>(y, x) = d < 0.3f ? 0.0f : (d > 2.9f ? 10.0f : d);
+                }
+            }
+            depthImages.push_back(depth);
+        }
+
+        pixels.clear();
+        pixels.setGeometry(30, 40, depthImages[0].step1());
+        for (int i = 0; i < 1001; ++i) {
+            uint32_t imgID = gen() % depthImages.size();
+            const cv::Mat &depth = depthImages[imgID];
+            int16_t x = static_cast<int16_t>(gen() % depth.cols);
+            int16_t y = static_cast<int16_t>(gen() % depth.rows);
+            float d = (i % 7 == 0) ? 0.5f : 0.05f + depthRand(gen) / 2;
+            int8_t classIndex = static_cast<int8_t>(gen() % grl::grlHandIndexNum);
+            pixels.push_back(x, y, d, depth.ptr<float>(), imgID, classIndex);
+        }
+    }
+
+    TEST_METHOD(avx2SameAsCPU)
+    {
+        Logger::WriteMessage("----In avx2SameAsCPU");
+
+        if (!grl::AVX2TrainingBackend::isSupported()) {
+            Logger::WriteMessage("AVX2 not supported, skipping");
+            return;
+        }
+
+        grl::CPUTrainingBackend cpu;
+        grl::AVX2TrainingBackend avx2;
+        Assert::IsTrue(cpu.setNodePixels(pixels, depthImages));
+        Assert::IsTrue(avx2.setNodePixels(pixels, depthImages));
+
+        std::mt19937 gen(5);
+        std::uniform_int_distribution<> offsetRand(-grl::learnOffsetDistr, grl::learnOffsetDistr);
+        std::uniform_real_distribution<float> thresholdRand(-grl::learnThresholdDistr, grl::learnThresholdDistr);
+        for (int i = 0; i < 100; ++i) {
+            grl::Decision decision;
+            decision.u.x = offsetRand(gen);
+            decision.u.y = offsetRand(gen);
+            decision.v.x = offsetRand(gen);
+            decision.v.y = offsetRand(gen);
+            decision.t = thresholdRand(gen);
+
+            std::vector<uint8_t> cpuDirections, avx2Directions;
+            grl::ClassCounts cpuCounts, avx2Counts;
+            Assert::IsTrue(cpu.evaluateDecision(decision, pixels, cpuDirections, cpuCounts));
+            Assert::IsTrue(avx2.evaluateDecision(decision, pixels, avx2Directions, avx2Counts));
+
+            Assert::IsTrue(cpuDirections == avx2Directions);
+            Assert::IsTrue(cpuCounts == avx2Counts);
+        }
+
+        Logger::WriteMessage("----avx2SameAsCPU Done");
+    }
+
+    TEST_METHOD(partition)
+    {
+        Logger::WriteMessage("----In partition");
+
+        std::vector<uint8_t> directions(pixels.size());
+        for (size_t i = 0; i < directions.size(); ++i)
+            directions[i] = (i % 3 == 0) ? grl::grlNodeGoLeft : grl::grlNodeGoRight;
+
+        grl::TrainingPixels left, right;
+        pixels.partition(directions, grl::grlNodeGoLeft, left, right);
+        Assert::AreEqual(pixels.size(), left.size() + right.size());
+        Assert::AreEqual(pixels.getStride(), left.getStride());
+        Assert::AreEqual(pixels.getCols(), right.getCols());
+
+        // Order of the pixels is kept on both sides
+        size_t l = 0, r = 0;
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            const grl::TrainingPixels &side = (i % 3 == 0) ? left : right;
+            size_t &j = (i % 3 == 0) ? l : r;
+            Assert::AreEqual(pixels.getX()[i], side.getX()[j]);
+            Assert::AreEqual(pixels.getY()[i], side.getY()[j]);
+            Assert::AreEqual(pixels.getInvDepth()[i], side.getInvDepth()[j]);
+            Assert::IsTrue(pixels.getImages()[i] == side.getImages()[j]);
+            Assert::AreEqual(pixels.getClasses()[i], side.getClasses()[j]);
+            ++j;
+        }
+
+        Logger::WriteMessage("----partition Done");
+    }
+
+    TEST_METHOD(trainingMemory)
+    {
+        Logger::WriteMessage("----In trainingMemory");
+
+        // Fails the evaluation of the candidates after the given number of them
+        class FailingBackend : public grl::CPUTrainingBackend
+        {
+        public:
+            explicit FailingBackend(int evaluations) : _evaluations(evaluations) {}
+
+            bool evaluateDecision(const grl::Decision &decision, const grl::TrainingPixels &pixels,
+                                  std::vector<uint8_t> &directions, grl::ClassCounts &leftCounts) override
+            {
+                return _evaluations-- != 0 &&
+                       grl::CPUTrainingBackend::evaluateDecision(decision, pixels, directions, leftCounts);
+            }
+
+        private:
+            int _evaluations;
+        };
+
+        // All memory is released when the training finishes and when it fails
+        // in the middle of the tree
+        for (int evaluations : { -1, 250 }) {
+            FailingBackend backend(evaluations);
+            grl::TreeMemoryTracker memory;
+            std::vector<grl::NodeMetrics> nodes;
+            grl::DecisionTree tree;
+            bool trained = tree.train(new grl::TrainingPixels(pixels), depthImages, 20, 6,
+                                      grl::RandomStream(7), backend, memory, nodes);
+            Assert::AreEqual(evaluations < 0, trained);
+            Assert::IsTrue(memory.getPeak() >= pixels.getMemorySize());
+            Assert::AreEqual(static_cast<size_t>(0), memory.getCurrent());
+
+            // Every decision node has both children
+            size_t treeNodes, treeLeaves;
+            int treeDepth;
+            tree.getSize(treeNodes, treeLeaves, treeDepth);
+            Assert::AreEqual(trained ? treeNodes / 2 + 1 : 0, treeLeaves);
+            Assert::IsTrue(treeDepth <= 6);
+        }
+
+        // The depth is the same everywhere and the offsets of the pixels in
+        // the middle do not leave the image, so no candidate splits the pixels
+        // and the root becomes the leaf
+        std::vector<cv::Mat> flatImages;
+        grl::TrainingPixels flatPixels;
+        flatPixels.setGeometry(pixels);
+        for (size_t i = 0; i < depthImages.size(); ++i)
+            flatImages.push_back(cv::Mat(depthImages[i].size(), CV_32FC1, cv::Scalar(1.0f)));
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            uint32_t imgID = pixels.getImageIDs()[i];
+            flatPixels.push_back(15, 20, 1.0f, flatImages[imgID].ptr<float>(),
+                                 imgID, pixels.getClasses()[i]);
+        }
+        grl::CPUTrainingBackend backend;
+        grl::TreeMemoryTracker memory;
+        std::vector<grl::NodeMetrics> nodes;
+        grl::DecisionTree tree;
+        Assert::IsTrue(tree.train(new grl::TrainingPixels(flatPixels), flatImages, 20, 6,
+                                  grl::RandomStream(7), backend, memory, nodes));
+        Assert::IsTrue(tree.getRoot()->isLeaf());
+        Assert::AreEqual(static_cast<size_t>(0), memory.getCurrent());
+
+        // The root was trained, but it is the only node and leaf of the tree
+        size_t treeNodes, treeLeaves;
+        int treeDepth;
+        tree.getSize(treeNodes, treeLeaves, treeDepth);
+        Assert::AreEqual(static_cast<size_t>(1), treeNodes);
+        Assert::AreEqual(static_cast<size_t>(1), treeLeaves);
+        Assert::AreEqual(1, treeDepth);
+
+        Logger::WriteMessage("----trainingMemory Done");
+    }
+
+    TEST_METHOD(backendSelection)
+    {
+        Logger::WriteMessage("----In backendSelection");
+
+        std::string error;
+        std::unique_ptr<grl::TrainingBackend> backend = grl::TrainingBackend::create(
+            grl::grlTrainingBackendCPU, nullptr, pixels.size(), error);
+        Assert::IsNotNull(backend.get());
+        Assert::AreEqual("CPU", backend->getName());
+
+        backend = grl::TrainingBackend::create(grl::grlTrainingBackendAuto, nullptr, pixels.size(), error);
+        Assert::IsNotNull(backend.get());
+
+#ifndef USE_GPU
+        // Not built, so it must fail with error instead of exiting
+        backend = grl::TrainingBackend::create(grl::grlTrainingBackendOpenCL, nullptr, pixels.size(), error);
+        Assert::IsNull(backend.get());
+        Assert::IsFalse(error.empty());
+#endif
+
+        Logger::WriteMessage("----backendSelection Done");
+    }
+};
+
+}